@@ -1,11 +1,30 @@
 #include "../pch.h"
 #include <algorithm>
+#include <array>
 #include <iterator>
 #include <map>
 
 #include "Intersection.h"
 
 #include "../Shapes/Shape.h"
+#include "../Shapes/Box.h"
+#include "../Shapes/Triangle.h"
+
+// SSE2 is always there on x86, AVX is checked for when the program runs
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define SN_SIMD
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define SN_AVX_FUNCTION
+#else
+#define SN_AVX_FUNCTION __attribute__((target("avx")))
+#endif
+// MSVC can use AVX intrinsics anywhere, other compilers only have the AVX lane kernels when compiling with AVX enabled
+#if defined(_MSC_VER) || defined(__AVX__)
+#define SN_AVX_LANES
+#endif
+#endif
 
 namespace Scuffed {
 
@@ -17,7 +36,483 @@ namespace Scuffed {
 #endif
 	}
 
-	float Intersection::projectionOverlapTest(const glm::vec3& testVec, const std::vector<glm::vec3>& vertices1, const std::vector<glm::vec3>& vertices2, bool &invertAxis) {
+	// ----SAT kernels----
+	// The SAT functions look at the shape types once and then run kernels that know the number of vertices and axes of both shapes at compile time.
+	// An axis and its opposite give the same result, so each is only tested once. Boxes store opposite face normals next to each other.
+	// The axes are projected in batches with SIMD, the tests on the projections run in the same order as before so the first separating axis still ends the search
+
+	struct SatKernels {
+		// Shape data read once per test, with the counts known at compile time. Stride skips the opposite normals of boxes
+		template<int NrOfVertices, int NrOfAxes, int NrOfEdges, int Stride>
+		struct FixedShape {
+			FixedShape(Shape* shape) {
+				vertices = shape->getVertices().begin();
+
+				const Vec3Span normals = shape->getNormals();
+				for (int i = 0; i < NrOfAxes; i++) {
+					axes[i] = normals[i * Stride];
+				}
+
+				const Vec3Span shapeEdges = shape->getEdges();
+				for (int i = 0; i < NrOfEdges; i++) {
+					edges[i] = shapeEdges[i * Stride];
+				}
+			}
+
+			int getNrOfVertices() const { return NrOfVertices; }
+			int getNrOfAxes() const { return NrOfAxes; }
+			int getNrOfEdges() const { return NrOfEdges; }
+			const glm::vec3* getVertices() const { return vertices; }
+			const glm::vec3& getAxis(int i) const { return axes[i]; }
+			const glm::vec3& getEdge(int i) const { return edges[i]; }
+
+			const glm::vec3* vertices;
+			std::array<glm::vec3, NrOfAxes> axes;
+			std::array<glm::vec3, NrOfEdges> edges;
+		};
+
+		typedef FixedShape<8, 3, 3, 2> BoxShape;
+		typedef FixedShape<3, 1, 3, 1> TriangleShape;
+		typedef FixedShape<1, 1, 0, 1> RayShape;
+
+		// Any other shape, tests every normal and edge it has
+		struct DynamicShape {
+			DynamicShape(Shape* shape) : vertices(shape->getVertices()), axes(shape->getNormals()), edges(shape->getEdges()) {}
+
+			int getNrOfVertices() const { return (int)vertices.size(); }
+			int getNrOfAxes() const { return (int)axes.size(); }
+			int getNrOfEdges() const { return (int)edges.size(); }
+			const glm::vec3* getVertices() const { return vertices.begin(); }
+			const glm::vec3& getAxis(int i) const { return axes[i]; }
+			const glm::vec3& getEdge(int i) const { return edges[i]; }
+
+			Vec3Span vertices;
+			Vec3Span axes;
+			Vec3Span edges;
+		};
+
+		template<class Kernel>
+		static auto dispatch(Shape* shape1, Shape* shape2, const Kernel& kernel) -> decltype(kernel(DynamicShape(shape1), DynamicShape(shape2))) {
+			switch (shape1->getType()) {
+			case ShapeTypes::Box:
+				return dispatchSecond(BoxShape(shape1), shape2, kernel);
+			case ShapeTypes::Triangle:
+				return dispatchSecond(TriangleShape(shape1), shape2, kernel);
+			case ShapeTypes::Ray:
+				return dispatchSecond(RayShape(shape1), shape2, kernel);
+			default:
+				return dispatchSecond(DynamicShape(shape1), shape2, kernel);
+			}
+		}
+
+		template<class Shape1, class Kernel>
+		static auto dispatchSecond(const Shape1& s1, Shape* shape2, const Kernel& kernel) -> decltype(kernel(s1, DynamicShape(shape2))) {
+			switch (shape2->getType()) {
+			case ShapeTypes::Box:
+				return kernel(s1, BoxShape(shape2));
+			case ShapeTypes::Triangle:
+				return kernel(s1, TriangleShape(shape2));
+			case ShapeTypes::Ray:
+				return kernel(s1, RayShape(shape2));
+			default:
+				return kernel(s1, DynamicShape(shape2));
+			}
+		}
+
+		// Axes in SoA form together with both shapes' projections on them. The axes are projected a batch at a time, several at once
+		struct AxisBatch {
+			static const int size = 8;
+
+			int count = 0;
+			alignas(32) float x[size];
+			alignas(32) float y[size];
+			alignas(32) float z[size];
+			alignas(32) float min1[size];
+			alignas(32) float max1[size];
+			alignas(32) float min2[size];
+			alignas(32) float max2[size];
+		};
+
+		// Projects the vertices on every axis in the batch. Same results as projecting them one axis at a time with Intersection::dot
+		static void project(const glm::vec3* vertices, const int nrOfVertices, const AxisBatch& batch, float* outMin, float* outMax) {
+#ifdef SN_SIMD
+			if (hasAvx()) {
+				projectAvx(vertices, nrOfVertices, batch, outMin, outMax);
+			}
+			else {
+				projectSse(vertices, nrOfVertices, batch, outMin, outMax);
+			}
+#else
+			for (int i = 0; i < batch.count; i++) {
+				const glm::vec3 axis(batch.x[i], batch.y[i], batch.z[i]);
+				outMin[i] = INFINITY;
+				outMax[i] = -INFINITY;
+				for (int j = 0; j < nrOfVertices; j++) {
+					float tempDot = Intersection::dot(vertices[j], axis);
+					if (tempDot < outMin[i]) {
+						outMin[i] = tempDot;
+					}
+					if (tempDot > outMax[i]) {
+						outMax[i] = tempDot;
+					}
+				}
+			}
+#endif
+		}
+
+#ifdef SN_SIMD
+		static bool detectAvx() {
+#ifdef _MSC_VER
+			int info[4];
+			__cpuid(info, 1);
+			const bool osSavesRegisters = (info[2] & (1 << 27)) != 0;
+			const bool cpuHasAvx = (info[2] & (1 << 28)) != 0;
+			return osSavesRegisters && cpuHasAvx && (_xgetbv(0) & 0x6) == 0x6;
+#else
+			return __builtin_cpu_supports("avx");
+#endif
+		}
+
+		static bool hasAvx() {
+			static const bool avx = detectAvx();
+			return avx;
+		}
+
+		// The dot products are added in the same order as the scalar version, and min/max keep the old value on ties, so the results are identical
+		static void projectSse(const glm::vec3* vertices, const int nrOfVertices, const AxisBatch& batch, float* outMin, float* outMax) {
+			for (int i = 0; i < batch.count; i += 4) {
+				const __m128 axisX = _mm_load_ps(batch.x + i);
+				const __m128 axisY = _mm_load_ps(batch.y + i);
+				const __m128 axisZ = _mm_load_ps(batch.z + i);
+
+				__m128 min = _mm_set1_ps(INFINITY);
+				__m128 max = _mm_set1_ps(-INFINITY);
+				for (int j = 0; j < nrOfVertices; j++) {
+					const __m128 xy = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(vertices[j].x), axisX), _mm_mul_ps(_mm_set1_ps(vertices[j].y), axisY));
+					const __m128 projection = _mm_add_ps(xy, _mm_mul_ps(_mm_set1_ps(vertices[j].z), axisZ));
+					min = _mm_min_ps(projection, min);
+					max = _mm_max_ps(projection, max);
+				}
+
+				_mm_store_ps(outMin + i, min);
+				_mm_store_ps(outMax + i, max);
+			}
+		}
+
+		SN_AVX_FUNCTION static void projectAvx(const glm::vec3* vertices, const int nrOfVertices, const AxisBatch& batch, float* outMin, float* outMax) {
+			const __m256 axisX = _mm256_load_ps(batch.x);
+			const __m256 axisY = _mm256_load_ps(batch.y);
+			const __m256 axisZ = _mm256_load_ps(batch.z);
+
+			__m256 min = _mm256_set1_ps(INFINITY);
+			__m256 max = _mm256_set1_ps(-INFINITY);
+			for (int j = 0; j < nrOfVertices; j++) {
+				const __m256 xy = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(vertices[j].x), axisX), _mm256_mul_ps(_mm256_set1_ps(vertices[j].y), axisY));
+				const __m256 projection = _mm256_add_ps(xy, _mm256_mul_ps(_mm256_set1_ps(vertices[j].z), axisZ));
+				min = _mm256_min_ps(projection, min);
+				max = _mm256_max_ps(projection, max);
+			}
+
+			_mm256_store_ps(outMin, min);
+			_mm256_store_ps(outMax, max);
+		}
+#endif
+
+		// Projects both shapes on the axes in the batch and calls test for each of them in order, until it returns false
+		template<class S1, class S2, class Test>
+		static bool testBatch(const S1& s1, const S2& s2, AxisBatch& batch, const Test& test) {
+			// Unused lanes get a zero axis so they don't hold garbage
+			for (int i = batch.count; i < AxisBatch::size; i++) {
+				batch.x[i] = batch.y[i] = batch.z[i] = 0.f;
+			}
+
+			project(s1.getVertices(), s1.getNrOfVertices(), batch, batch.min1, batch.max1);
+			project(s2.getVertices(), s2.getNrOfVertices(), batch, batch.min2, batch.max2);
+
+			for (int i = 0; i < batch.count; i++) {
+				if (!test(glm::vec3(batch.x[i], batch.y[i], batch.z[i]), batch.min1[i], batch.max1[i], batch.min2[i], batch.max2[i])) {
+					return false;
+				}
+			}
+
+			batch.count = 0;
+			return true;
+		}
+
+		template<class S1, class S2, class Test>
+		static bool addAxis(const S1& s1, const S2& s2, AxisBatch& batch, const glm::vec3& axis, const Test& test) {
+			batch.x[batch.count] = axis.x;
+			batch.y[batch.count] = axis.y;
+			batch.z[batch.count] = axis.z;
+			batch.count++;
+
+			return batch.count < AxisBatch::size || testBatch(s1, s2, batch, test);
+		}
+
+		// Calls test with every axis that can separate the shapes and the shapes' projections on it, until it returns false.
+		// The face axes of both shapes come first and then the cross products of their edges. Parallel edges don't give an axis
+		template<class S1, class S2, class Test>
+		static bool forEachAxis(const S1& s1, const S2& s2, const Test& test) {
+			AxisBatch batch;
+
+			for (int i = 0; i < s1.getNrOfAxes(); i++) {
+				if (!addAxis(s1, s2, batch, s1.getAxis(i), test)) {
+					return false;
+				}
+			}
+
+			for (int i = 0; i < s2.getNrOfAxes(); i++) {
+				if (!addAxis(s1, s2, batch, s2.getAxis(i), test)) {
+					return false;
+				}
+			}
+
+			for (int i = 0; i < s1.getNrOfEdges(); i++) {
+				const glm::vec3& e1 = s1.getEdge(i);
+				for (int j = 0; j < s2.getNrOfEdges(); j++) {
+					const glm::vec3& e2 = s2.getEdge(j);
+					if (e1 != e2 && e1 != -e2) {
+						glm::vec3 testVec = glm::cross(e1, e2);
+						if (glm::length2(testVec) > 0.f && !addAxis(s1, s2, batch, glm::normalize(testVec), test)) {
+							return false;
+						}
+					}
+				}
+			}
+
+			return batch.count == 0 || testBatch(s1, s2, batch, test);
+		}
+
+		// Same as Intersection::projectionOverlapTest
+		static float overlap(const float min1, const float max1, const float min2, const float max2, bool& invertAxis) {
+			invertAxis = false;
+			if (max2 >= min1 && max1 >= min2) {
+				if (max2 - min1 < max1 - min2) {
+					return max2 - min1;
+				}
+				else {
+					invertAxis = true;
+					return max1 - min2;
+				}
+			}
+			return -1.f;
+		}
+
+		template<class S1, class S2>
+		static bool intersects(const S1& s1, const S2& s2) {
+			return forEachAxis(s1, s2, [&](const glm::vec3&, float min1, float max1, float min2, float max2) {
+				bool invertAxis;
+				return overlap(min1, max1, min2, max2, invertAxis) >= 0.f;
+			});
+		}
+
+		// Finds the axis with the smallest overlap, pointing from shape2 towards shape1
+		template<class S1, class S2>
+		static bool intersectionAxis(const S1& s1, const S2& s2, glm::vec3& outAxis, float& outDepth) {
+			outDepth = INFINITY;
+			return forEachAxis(s1, s2, [&](const glm::vec3& axis, float min1, float max1, float min2, float max2) {
+				bool invertAxis;
+				float intersection = overlap(min1, max1, min2, max2, invertAxis);
+				if (intersection < 0.f) {
+					return false;
+				}
+
+				// Save smallest
+				if (intersection < outDepth) {
+					outDepth = intersection;
+					outAxis = invertAxis ? -axis : axis;
+				}
+				return true;
+			});
+		}
+
+		template<class S1, class S2>
+		static float continousIntersection(const S1& s1, const S2& s2, const glm::vec3& relativeVel, const float dt) {
+			float timeFirst = 0.f;
+			float timeLast = INFINITY;
+
+			bool intersects = forEachAxis(s1, s2, [&](const glm::vec3& axis, float min1, float max1, float min2, float max2) {
+				return Intersection::continousIntervalTest(min1, max1, min2, max2, Intersection::dot(axis, relativeVel), timeFirst, timeLast, dt);
+			});
+
+			return intersects ? timeFirst : -1.0f;
+		}
+#ifdef SN_SIMD
+		// Operations on a register of lanes, so the packet kernels can be written once for both SSE and AVX
+		struct SseLanes {
+			typedef __m128 V;
+			static const int width = 4;
+
+			static V load(const float* p) { return _mm_load_ps(p); }
+			static void store(float* p, V a) { _mm_store_ps(p, a); }
+			static V set(float a) { return _mm_set1_ps(a); }
+			static V add(V a, V b) { return _mm_add_ps(a, b); }
+			static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+			static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+			static V div(V a, V b) { return _mm_div_ps(a, b); }
+			static V sqrt(V a) { return _mm_sqrt_ps(a); }
+			static V min(V a, V b) { return _mm_min_ps(a, b); } // a < b ? a : b
+			static V max(V a, V b) { return _mm_max_ps(a, b); } // a > b ? a : b
+			static V lessThan(V a, V b) { return _mm_cmplt_ps(a, b); }
+			static V lessEqual(V a, V b) { return _mm_cmple_ps(a, b); }
+			static V greaterThan(V a, V b) { return _mm_cmpgt_ps(a, b); }
+			static V greaterEqual(V a, V b) { return _mm_cmpge_ps(a, b); }
+			static V equal(V a, V b) { return _mm_cmpeq_ps(a, b); }
+			static V bitAnd(V a, V b) { return _mm_and_ps(a, b); }
+			static V bitOr(V a, V b) { return _mm_or_ps(a, b); }
+			static V andNot(V a, V b) { return _mm_andnot_ps(a, b); } // ~a & b
+			static V select(V mask, V a, V b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+		};
+
+#ifdef SN_AVX_LANES
+		struct AvxLanes {
+			typedef __m256 V;
+			static const int width = 8;
+
+			static V load(const float* p) { return _mm256_load_ps(p); }
+			static void store(float* p, V a) { _mm256_store_ps(p, a); }
+			static V set(float a) { return _mm256_set1_ps(a); }
+			static V add(V a, V b) { return _mm256_add_ps(a, b); }
+			static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+			static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+			static V div(V a, V b) { return _mm256_div_ps(a, b); }
+			static V sqrt(V a) { return _mm256_sqrt_ps(a); }
+			static V min(V a, V b) { return _mm256_min_ps(a, b); }
+			static V max(V a, V b) { return _mm256_max_ps(a, b); }
+			static V lessThan(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+			static V lessEqual(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+			static V greaterThan(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+			static V greaterEqual(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+			static V equal(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+			static V bitAnd(V a, V b) { return _mm256_and_ps(a, b); }
+			static V bitOr(V a, V b) { return _mm256_or_ps(a, b); }
+			static V andNot(V a, V b) { return _mm256_andnot_ps(a, b); }
+			static V select(V mask, V a, V b) { return _mm256_blendv_ps(b, a, mask); }
+		};
+#endif
+
+		// The box data every lane shares
+		struct PacketBox {
+			glm::vec3 vertices[8];
+			glm::vec3 axes[3]; // Also the edge directions
+		};
+
+		// One step of continousIntervalTest for every lane, only applied to the lanes in valid.
+		// Lanes that would have returned false are marked in failed, the rest of the test gives the same times regardless of which step they fail in
+		template<class L>
+		static void continousIntervalLanes(typename L::V min1, typename L::V max1, typename L::V min2, typename L::V max2, typename L::V speed, typename L::V valid, typename L::V& timeFirst, typename L::V& timeLast, typename L::V& failed) {
+			typedef typename L::V V;
+			const V zero = L::set(0.f);
+
+			const V left = L::lessThan(max2, min1); // Interval (2) initially on left of interval (1)
+			const V right = L::andNot(left, L::lessThan(max1, min2)); // Interval (2) initially on right of interval (1)
+
+			// Intervals moving apart
+			const V apart = L::bitOr(L::bitAnd(left, L::lessEqual(speed, zero)), L::bitAnd(right, L::greaterEqual(speed, zero)));
+			failed = L::bitOr(failed, L::bitAnd(valid, apart));
+
+			const V a = L::div(L::sub(min1, max2), speed);
+			const V b = L::div(L::sub(max1, min2), speed);
+
+			V first = L::select(left, a, L::select(right, b, L::set(-INFINITY)));
+			V last = L::select(L::greaterThan(speed, zero), b, L::select(L::lessThan(speed, zero), a, L::set(INFINITY)));
+			last = L::select(left, b, L::select(right, a, last));
+
+			first = L::select(valid, first, L::set(-INFINITY));
+			last = L::select(valid, last, L::set(INFINITY));
+			timeFirst = L::max(first, timeFirst);
+			timeLast = L::min(last, timeLast);
+		}
+
+		template<class L>
+		static void projectLanes(const typename L::V* x, const typename L::V* y, const typename L::V* z, const int nrOfVertices, typename L::V axisX, typename L::V axisY, typename L::V axisZ, typename L::V& outMin, typename L::V& outMax) {
+			outMin = L::set(INFINITY);
+			outMax = L::set(-INFINITY);
+			for (int i = 0; i < nrOfVertices; i++) {
+				const typename L::V projection = L::add(L::add(L::mul(x[i], axisX), L::mul(y[i], axisY)), L::mul(z[i], axisZ));
+				outMin = L::min(projection, outMin);
+				outMax = L::max(projection, outMax);
+			}
+		}
+
+		// continousSAT between the box and L::width triangles of the packet, starting at firstLane. Tests the same axes as the BoxShape and TriangleShape kernel
+		template<class L>
+		static void continousBoxTriangles(const PacketBox& box, const Intersection::TrianglePacket& packet, const int firstLane, const glm::vec3& relativeVel, const float dt, float* outTimes) {
+			typedef typename L::V V;
+
+			V boxX[8], boxY[8], boxZ[8];
+			for (int i = 0; i < 8; i++) {
+				boxX[i] = L::set(box.vertices[i].x);
+				boxY[i] = L::set(box.vertices[i].y);
+				boxZ[i] = L::set(box.vertices[i].z);
+			}
+
+			V triX[3], triY[3], triZ[3];
+			V edgeX[3], edgeY[3], edgeZ[3];
+			for (int i = 0; i < 3; i++) {
+				triX[i] = L::load(packet.vertices[i][0] + firstLane);
+				triY[i] = L::load(packet.vertices[i][1] + firstLane);
+				triZ[i] = L::load(packet.vertices[i][2] + firstLane);
+				edgeX[i] = L::load(packet.edges[i][0] + firstLane);
+				edgeY[i] = L::load(packet.edges[i][1] + firstLane);
+				edgeZ[i] = L::load(packet.edges[i][2] + firstLane);
+			}
+
+			const V velX = L::set(relativeVel.x);
+			const V velY = L::set(relativeVel.y);
+			const V velZ = L::set(relativeVel.z);
+			const V allLanes = L::equal(velX, velX);
+
+			V timeFirst = L::set(0.f);
+			V timeLast = L::set(INFINITY);
+			V failed = L::set(0.f);
+
+			auto testAxis = [&](V axisX, V axisY, V axisZ, V valid) {
+				V min1, max1, min2, max2;
+				projectLanes<L>(boxX, boxY, boxZ, 8, axisX, axisY, axisZ, min1, max1);
+				projectLanes<L>(triX, triY, triZ, 3, axisX, axisY, axisZ, min2, max2);
+				const V speed = L::add(L::add(L::mul(axisX, velX), L::mul(axisY, velY)), L::mul(axisZ, velZ));
+				continousIntervalLanes<L>(min1, max1, min2, max2, speed, valid, timeFirst, timeLast, failed);
+			};
+
+			// Face axes
+			for (int i = 0; i < 3; i++) {
+				testAxis(L::set(box.axes[i].x), L::set(box.axes[i].y), L::set(box.axes[i].z), allLanes);
+			}
+			testAxis(L::load(packet.normals[0] + firstLane), L::load(packet.normals[1] + firstLane), L::load(packet.normals[2] + firstLane), allLanes);
+
+			// Edge cross products, calculated like glm::normalize(glm::cross(e1, e2))
+			for (int i = 0; i < 3; i++) {
+				const V e1X = L::set(box.axes[i].x);
+				const V e1Y = L::set(box.axes[i].y);
+				const V e1Z = L::set(box.axes[i].z);
+				const V minusE1X = L::set(-box.axes[i].x);
+				const V minusE1Y = L::set(-box.axes[i].y);
+				const V minusE1Z = L::set(-box.axes[i].z);
+
+				for (int j = 0; j < 3; j++) {
+					const V crossX = L::sub(L::mul(e1Y, edgeZ[j]), L::mul(edgeY[j], e1Z));
+					const V crossY = L::sub(L::mul(e1Z, edgeX[j]), L::mul(edgeZ[j], e1X));
+					const V crossZ = L::sub(L::mul(e1X, edgeY[j]), L::mul(edgeX[j], e1Y));
+					const V length2 = L::add(L::add(L::mul(crossX, crossX), L::mul(crossY, crossY)), L::mul(crossZ, crossZ));
+
+					const V same = L::bitAnd(L::bitAnd(L::equal(e1X, edgeX[j]), L::equal(e1Y, edgeY[j])), L::equal(e1Z, edgeZ[j]));
+					const V opposite = L::bitAnd(L::bitAnd(L::equal(minusE1X, edgeX[j]), L::equal(minusE1Y, edgeY[j])), L::equal(minusE1Z, edgeZ[j]));
+					const V valid = L::andNot(L::bitOr(same, opposite), L::greaterThan(length2, L::set(0.f)));
+
+					const V inverseLength = L::div(L::set(1.f), L::sqrt(length2));
+					testAxis(L::mul(crossX, inverseLength), L::mul(crossY, inverseLength), L::mul(crossZ, inverseLength), valid);
+				}
+			}
+
+			failed = L::bitOr(failed, L::bitOr(L::greaterThan(timeFirst, L::set(dt)), L::greaterThan(timeFirst, timeLast)));
+			L::store(outTimes + firstLane, L::select(failed, L::set(-1.f), timeFirst));
+		}
+#endif
+	};
+	// -------------------
+
+	float Intersection::projectionOverlapTest(const glm::vec3& testVec, const Vec3Span& vertices1, const Vec3Span& vertices2, bool &invertAxis) {
 		invertAxis = false;
 		float min1 = INFINITY, min2 = INFINITY;
 		float max1 = -INFINITY, max2 = -INFINITY;
@@ -59,45 +554,12 @@ namespace Scuffed {
 	}
 
 	bool Intersection::SAT(Shape* shape1, Shape* shape2) {
-		bool invertAxis = false;
-		const std::vector<glm::vec3>& s1Norms = shape1->getNormals();
-		for (const auto& it : s1Norms) {
-			float intersection = projectionOverlapTest(it, shape1->getVertices(), shape2->getVertices(), invertAxis);
-			if (intersection < 0.f) {
-				return false;
-			}
-		}
-
-		const std::vector<glm::vec3>& s2Norms = shape2->getNormals();
-		for (const auto& it : s2Norms) {
-			float intersection = projectionOverlapTest(it, shape1->getVertices(), shape2->getVertices(), invertAxis);
-			if (intersection < 0.f) {
-				return false;
-			}
-		}
-
-		const std::vector<glm::vec3>& s1Edges = shape1->getEdges();
-		const std::vector<glm::vec3>& s2Edges = shape2->getEdges();
-
-		glm::vec3 testVec;
-
-		// Calculate cross vectors
-		for (const auto& e1 : s1Edges) {
-			for (const auto& e2 : s2Edges) {
-				if (e1 != e2 && e1 != -e2) {
-					testVec = glm::normalize(glm::cross(e1, e2));
-					float intersection = projectionOverlapTest(testVec, shape1->getVertices(), shape2->getVertices(), invertAxis);
-					if (intersection < 0.f) {
-						return false;
-					}
-				}
-			}
-		}
-
-		return true;
+		return SatKernels::dispatch(shape1, shape2, [](const auto& s1, const auto& s2) {
+			return SatKernels::intersects(s1, s2);
+		});
 	}
 
-	std::vector<glm::vec3> Intersection::getManifold(const glm::vec3& testVec, const std::vector<glm::vec3>& vertices1, const std::vector<glm::vec3>& vertices2) {
+	std::vector<glm::vec3> Intersection::getManifold(const glm::vec3& testVec, const Vec3Span& vertices1, const Vec3Span& vertices2) {
 		float min1 = INFINITY, min2 = INFINITY;
 		float max1 = -INFINITY, max2 = -INFINITY;
 
@@ -217,73 +679,14 @@ namespace Scuffed {
 	}
 
 	bool Intersection::SAT(Shape* shape1, Shape* shape2, std::vector<glm::vec3>& manifold) {
-		bool invertAxis = false;
-
 		float intersectionDepth = INFINITY;
 		glm::vec3 intersectionAxis(0.f);
 
-		const std::vector<glm::vec3>& s1Norms = shape1->getNormals();
-		for (const auto& it : s1Norms) {
-			float intersection = projectionOverlapTest(it, shape1->getVertices(), shape2->getVertices(), invertAxis);
-			if (intersection < 0.f) {
-				return false;
-			}
-			else {
-				// Save smallest 
-				if (intersection < intersectionDepth) {
-					intersectionDepth = intersection;
-					intersectionAxis = it;
-					if (invertAxis) {
-						intersectionAxis = -intersectionAxis;
-					}
-				}
-			}
-		}
-
-		const std::vector<glm::vec3>& s2Norms = shape2->getNormals();
-		for (const auto& it : s2Norms) {
-			float intersection = projectionOverlapTest(it, shape1->getVertices(), shape2->getVertices(), invertAxis);
-			if (intersection < 0.f) {
-				return false;
-			}
-			else {
-				// Save smallest 
-				if (intersection < intersectionDepth) {
-					intersectionDepth = intersection;
-					intersectionAxis = it;
-					if (invertAxis) {
-						intersectionAxis = -intersectionAxis;
-					}
-				}
-			}
-		}
-
-		const std::vector<glm::vec3>& s1Edges = shape1->getEdges();
-		const std::vector<glm::vec3>& s2Edges = shape2->getEdges();
-
-		glm::vec3 testVec;
-
-		// Calculate cross vectors
-		for (const auto& e1 : s1Edges) {
-			for (const auto& e2 : s2Edges) {
-				if (e1 != e2 && e1 != -e2) {
-					testVec = glm::normalize(glm::cross(e1, e2));
-					float intersection = projectionOverlapTest(testVec, shape1->getVertices(), shape2->getVertices(), invertAxis);
-					if (intersection < 0.f) {
-						return false;
-					}
-					else {
-						// Save smallest 
-						if (intersection < intersectionDepth) {
-							intersectionDepth = intersection;
-							intersectionAxis = testVec;
-							if (invertAxis) {
-								intersectionAxis = -intersectionAxis;
-							}
-						}
-					}
-				}
-			}
+		bool intersects = SatKernels::dispatch(shape1, shape2, [&](const auto& s1, const auto& s2) {
+			return SatKernels::intersectionAxis(s1, s2, intersectionAxis, intersectionDepth);
+		});
+		if (!intersects) {
+			return false;
 		}
 
 		manifold = getManifold(intersectionAxis, shape1->getVertices(), shape2->getVertices());
@@ -292,81 +695,12 @@ namespace Scuffed {
 	}
 
 	bool Intersection::SAT(Shape* shape1, Shape* shape2, glm::vec3* intersectionAxis, float* intersectionDepth) {
-		bool invertAxis = false;
-		*intersectionDepth = INFINITY;
-
-		const std::vector<glm::vec3>& s1Norms = shape1->getNormals();
-		for (const auto& it : s1Norms) {
-			float intersection = projectionOverlapTest(it, shape1->getVertices(), shape2->getVertices(), invertAxis);
-			if (intersection < 0.f) {
-				return false;
-			}
-			else {
-				// Save smallest 
-				if (intersection < *intersectionDepth) {
-					*intersectionDepth = intersection;
-					*intersectionAxis = it;
-					if (invertAxis) {
-						*intersectionAxis = -*intersectionAxis;
-					}
-				}
-			}
-		}
-
-		const std::vector<glm::vec3>& s2Norms = shape2->getNormals();
-		for (const auto& it : s2Norms) {
-			float intersection = projectionOverlapTest(it, shape1->getVertices(), shape2->getVertices(), invertAxis);
-			if (intersection < 0.f) {
-				return false;
-			}
-			else {
-				// Save smallest 
-				if (intersection < *intersectionDepth) {
-					*intersectionDepth = intersection;
-					*intersectionAxis = it;
-					if (invertAxis) {
-						*intersectionAxis = -*intersectionAxis;
-					}
-				}
-			}
-		}
-
-		const std::vector<glm::vec3>& s1Edges = shape1->getEdges();
-		const std::vector<glm::vec3>& s2Edges = shape2->getEdges();
-
-		glm::vec3 testVec;
-
-		// Calculate cross vectors
-		for (const auto& e1 : s1Edges) {
-			for (const auto& e2 : s2Edges) {
-				if (e1 != e2 && e1 != -e2) {
-					testVec = glm::cross(e1, e2);
-					if (glm::length2(testVec) > 0.f) {
-						testVec = glm::normalize(testVec);
-
-						float intersection = projectionOverlapTest(testVec, shape1->getVertices(), shape2->getVertices(), invertAxis);
-						if (intersection < 0.f) {
-							return false;
-						}
-						else {
-							// Save smallest 
-							if (intersection < *intersectionDepth) {
-								*intersectionDepth = intersection;
-								*intersectionAxis = testVec;
-								if (invertAxis) {
-									*intersectionAxis = -*intersectionAxis;
-								}
-							}
-						}
-					}
-				}
-			}
-		}
-
-		return true;
+		return SatKernels::dispatch(shape1, shape2, [&](const auto& s1, const auto& s2) {
+			return SatKernels::intersectionAxis(s1, s2, *intersectionAxis, *intersectionDepth);
+		});
 	}
 
-	bool Intersection::continousOverlapTest(const glm::vec3& testVec, const std::vector<glm::vec3>& vertices1, const std::vector<glm::vec3>& vertices2, const glm::vec3& relativeVel, float& timeFirst, float& timeLast, const float timeMax) {
+	bool Intersection::continousOverlapTest(const glm::vec3& testVec, const Vec3Span& vertices1, const Vec3Span& vertices2, const glm::vec3& relativeVel, float& timeFirst, float& timeLast, const float timeMax) {
 		float min1 = INFINITY, min2 = INFINITY;
 		float max1 = -INFINITY, max2 = -INFINITY;
 
@@ -394,11 +728,13 @@ namespace Scuffed {
 			}
 		}
 
+		return continousIntervalTest(min1, max1, min2, max2, dot(testVec, relativeVel), timeFirst, timeLast, timeMax);
+	}
+
+	bool Intersection::continousIntervalTest(const float min1, const float max1, const float min2, const float max2, const float speed, float& timeFirst, float& timeLast, const float timeMax) {
 		//Following found here: https://www.geometrictools.com/Documentation/MethodOfSeparatingAxes.pdf
 
 		float T;
-		float speed = dot(testVec, relativeVel);
-
 		if (max2 < min1) { // Interval (2) initially on left of interval (1)
 			if (speed <= 0.f) { return false; } // Intervals moving apart
 
@@ -438,45 +774,266 @@ namespace Scuffed {
 	}
 
 	float Intersection::continousSAT(Shape* shape1, Shape* shape2, const glm::vec3& vel1, const glm::vec3& vel2, const float dt) {
-
 		// Treat shape1 as stationary and shape2 as moving
 		glm::vec3 relativeVel = vel2 - vel1;
 
+		return SatKernels::dispatch(shape1, shape2, [&](const auto& s1, const auto& s2) {
+			return SatKernels::continousIntersection(s1, s2, relativeVel, dt);
+		});
+	}
+
+	void Intersection::continousSAT(Box* box, const TrianglePacket& triangles, const glm::vec3& vel1, const glm::vec3& vel2, const float dt, float* outTimes) {
+		// Treat the box as stationary and the triangles as moving
+		glm::vec3 relativeVel = vel2 - vel1;
+
+#ifdef SN_SIMD
+		SatKernels::PacketBox packetBox;
+		const Vec3Span vertices = box->getVertices();
+		const Vec3Span normals = box->getNormals();
+		for (int i = 0; i < 8; i++) {
+			packetBox.vertices[i] = vertices[i];
+		}
+		for (int i = 0; i < 3; i++) {
+			packetBox.axes[i] = normals[i * 2];
+		}
+
+		alignas(32) float times[TrianglePacket::size];
+#ifdef SN_AVX_LANES
+		if (SatKernels::hasAvx()) {
+			SatKernels::continousBoxTriangles<SatKernels::AvxLanes>(packetBox, triangles, 0, relativeVel, dt, times);
+		}
+		else
+#endif
+		{
+			for (int i = 0; i < triangles.count; i += SatKernels::SseLanes::width) {
+				SatKernels::continousBoxTriangles<SatKernels::SseLanes>(packetBox, triangles, i, relativeVel, dt, times);
+			}
+		}
+
+		for (int i = 0; i < triangles.count; i++) {
+			outTimes[i] = times[i];
+		}
+#else
+		Triangle triangle(glm::vec3(0.f), glm::vec3(0.f), glm::vec3(0.f));
+		for (int i = 0; i < triangles.count; i++) {
+			triangle.setData(triangles.getVertex(i, 0), triangles.getVertex(i, 1), triangles.getVertex(i, 2));
+			outTimes[i] = continousSAT(box, &triangle, vel1, vel2, dt);
+		}
+#endif
+	}
+
+	void Intersection::TrianglePacket::add(Shape* triangle) {
+		add(triangle->getVertices().begin(), triangle->getEdges().begin(), triangle->getNormals()[0]);
+	}
+
+	void Intersection::TrianglePacket::add(const glm::vec3 triangleVertices[3], const glm::vec3 triangleEdges[3], const glm::vec3& normal) {
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 3; j++) {
+				vertices[i][j][count] = triangleVertices[i][j];
+				edges[i][j][count] = triangleEdges[i][j];
+			}
+			normals[i][count] = normal[i];
+		}
+
+		count++;
+	}
+
+	glm::vec3 Intersection::TrianglePacket::getVertex(int triangle, int vertex) const {
+		return glm::vec3(vertices[vertex][0][triangle], vertices[vertex][1][triangle], vertices[vertex][2][triangle]);
+	}
+
+	float Intersection::continousAABB(const glm::vec3& min1, const glm::vec3& max1, const glm::vec3& min2, const glm::vec3& max2, const glm::vec3& vel1, const glm::vec3& vel2, const float dt) {
+		// Same as continousSAT but only the x, y and z axes need to be tested
+		glm::vec3 relativeVel = vel2 - vel1;
+
 		float timeFirst = 0.f;
 		float timeLast = INFINITY;
 
-		const std::vector<glm::vec3>& s1Norms = shape1->getNormals();
-		for (const auto& it : s1Norms) {
-			if (!continousOverlapTest(it, shape1->getVertices(), shape2->getVertices(), relativeVel, timeFirst, timeLast, dt)) {
+		for (int i = 0; i < 3; i++) {
+			if (!continousIntervalTest(min1[i], max1[i], min2[i], max2[i], relativeVel[i], timeFirst, timeLast, dt)) {
 				return -1.0f;
 			}
 		}
 
-		const std::vector<glm::vec3>& s2Norms = shape2->getNormals();
-		for (const auto& it : s2Norms) {
-			if (!continousOverlapTest(it, shape1->getVertices(), shape2->getVertices(), relativeVel, timeFirst, timeLast, dt)) {
-				return -1.0f;
+		return timeFirst;
+	}
+
+	float Intersection::conservativeAdvancement(Box* box, const glm::vec3& pivot, const glm::vec3& angularVel, Shape* shape, const glm::vec3& vel1, const glm::vec3& vel2, const float maxTime, float& outSafeTime) {
+		// Treat the shape as stationary and the box as moving
+		const glm::vec3 relativeVel = vel1 - vel2;
+
+		const Vec3Span boxVertices = box->getVertices();
+		const Vec3Span boxNormals = box->getNormals();
+
+		glm::vec3 offsets[8]; // Corners relative to the pivot
+		float radius = 0.f;
+		for (int i = 0; i < 8; i++) {
+			offsets[i] = boxVertices[i] - pivot;
+			radius = glm::max(radius, glm::length(offsets[i]));
+		}
+
+		glm::vec3 boxAxes[3];
+		for (int i = 0; i < 3; i++) {
+			boxAxes[i] = boxNormals[i * 2];
+		}
+
+		// The shape doesn't turn, so its axes are only read once
+		const Vec3Span shapeVertices = shape->getVertices();
+		glm::vec3 shapeAxes[3];
+		glm::vec3 shapeEdges[3];
+		int nrOfShapeAxes = 0;
+		getSeparatingAxes(shape, shapeAxes, nrOfShapeAxes, shapeEdges);
+
+		const float angularSpeed = glm::length(angularVel);
+		const glm::vec3 rotationAxis = angularSpeed > 0.f ? angularVel / angularSpeed : glm::vec3(0.f, 1.f, 0.f);
+
+		// No corner of the box moves towards the shape faster than this
+		const float maxSpeed = glm::length(relativeVel) + angularSpeed * radius;
+
+		// Gaps this small count as touching, same size as the nudge the collision handling gives after moving to a collision
+		const float tolerance = 0.0001f;
+		const int maxIterations = 32;
+
+		float time = 0.f;
+		for (int iteration = 0; iteration < maxIterations; iteration++) {
+			const glm::mat3 rotation = glm::mat3_cast(glm::angleAxis(angularSpeed * time, rotationAxis));
+			const glm::vec3 position = pivot + relativeVel * time;
+
+			glm::vec3 vertices[8];
+			for (int i = 0; i < 8; i++) {
+				vertices[i] = position + rotation * offsets[i];
+			}
+
+			glm::vec3 axes[3];
+			for (int i = 0; i < 3; i++) {
+				axes[i] = rotation * boxAxes[i];
+			}
+
+			const float distance = separatingDistance(vertices, 8, axes, 3, shapeVertices.begin(), (int)shapeVertices.size(), shapeAxes, nrOfShapeAxes, shapeEdges, 3);
+			if (distance <= tolerance) {
+				outSafeTime = time;
+				return time;
+			}
+
+			if (maxSpeed <= 0.f) {
+				outSafeTime = INFINITY;
+				return -1.f;
+			}
+
+			time += distance / maxSpeed;
+			if (time > maxTime) {
+				outSafeTime = INFINITY;
+				return -1.f;
+			}
+		}
+
+		// Still apart, but every step was safe so the box can be moved this far. It is not a hit, since the shapes might never touch
+		outSafeTime = time;
+		return -1.f;
+	}
+
+	float Intersection::separation(Box* box, const glm::vec3* triangleVertices, const glm::vec3* triangleEdges, const glm::vec3& triangleNormal) {
+		const Vec3Span boxVertices = box->getVertices();
+		const Vec3Span boxNormals = box->getNormals();
+		glm::vec3 boxAxes[3];
+		for (int i = 0; i < 3; i++) {
+			boxAxes[i] = boxNormals[i * 2];
+		}
+
+		return separatingDistance(boxVertices.begin(), (int)boxVertices.size(), boxAxes, 3, triangleVertices, 3, &triangleNormal, 1, triangleEdges, 3);
+	}
+
+	glm::vec3 Intersection::separatingAxis(Box* box, Shape* shape) {
+		const Vec3Span boxVertices = box->getVertices();
+		const Vec3Span boxNormals = box->getNormals();
+		glm::vec3 boxAxes[3];
+		for (int i = 0; i < 3; i++) {
+			boxAxes[i] = boxNormals[i * 2];
+		}
+
+		const Vec3Span shapeVertices = shape->getVertices();
+		glm::vec3 shapeAxes[3];
+		glm::vec3 shapeEdges[3];
+		int nrOfShapeAxes = 0;
+		getSeparatingAxes(shape, shapeAxes, nrOfShapeAxes, shapeEdges);
+
+		glm::vec3 axis(0.f);
+		separatingDistance(boxVertices.begin(), (int)boxVertices.size(), boxAxes, 3, shapeVertices.begin(), (int)shapeVertices.size(), shapeAxes, nrOfShapeAxes, shapeEdges, 3, &axis);
+		return axis;
+	}
+
+	void Intersection::getSeparatingAxes(Shape* shape, glm::vec3* outAxes, int& outNrOfAxes, glm::vec3* outEdges) {
+		if (shape->getType() == ShapeTypes::Box) {
+			const Vec3Span normals = shape->getNormals();
+			for (int i = 0; i < 3; i++) {
+				outAxes[i] = normals[i * 2];
+				outEdges[i] = normals[i * 2];
+			}
+			outNrOfAxes = 3;
+		}
+		else {
+			const Vec3Span edges = shape->getEdges();
+			for (int i = 0; i < 3; i++) {
+				outEdges[i] = edges[i];
 			}
+			outAxes[0] = shape->getNormals()[0];
+			outNrOfAxes = 1;
 		}
+	}
 
-		const std::vector<glm::vec3>& s1Edges = shape1->getEdges();
-		const std::vector<glm::vec3>& s2Edges = shape2->getEdges();
+	float Intersection::separatingDistance(const glm::vec3* vertices1, const int nrOfVertices1, const glm::vec3* axes1, const int nrOfAxes1, const glm::vec3* vertices2, const int nrOfVertices2, const glm::vec3* axes2, const int nrOfAxes2, const glm::vec3* edges2, const int nrOfEdges2, glm::vec3* outAxis) {
+		float maxGap = -INFINITY;
 
-		glm::vec3 testVec;
+		auto testAxis = [&](const glm::vec3& axis) {
+			// Flat boxes have NaN normals, which are skipped by the comparison
+			if (!(glm::length2(axis) > 0.f)) {
+				return;
+			}
 
-		// Calculate cross vectors
-		for (const auto& e1 : s1Edges) {
-			for (const auto& e2 : s2Edges) {
-				if (e1 != e2 && e1 != -e2) {
-					testVec = glm::normalize(glm::cross(e1, e2));
-					if (!continousOverlapTest(testVec, shape1->getVertices(), shape2->getVertices(), relativeVel, timeFirst, timeLast, dt)) {
-						return -1.0f;
-					}
+			float min1 = INFINITY, min2 = INFINITY;
+			float max1 = -INFINITY, max2 = -INFINITY;
+
+			for (int i = 0; i < nrOfVertices1; i++) {
+				float tempDot = dot(vertices1[i], axis);
+				min1 = glm::min(min1, tempDot);
+				max1 = glm::max(max1, tempDot);
+			}
+
+			for (int i = 0; i < nrOfVertices2; i++) {
+				float tempDot = dot(vertices2[i], axis);
+				min2 = glm::min(min2, tempDot);
+				max2 = glm::max(max2, tempDot);
+			}
+
+			const float gap = glm::max(min2 - max1, min1 - max2);
+			if (gap > maxGap) {
+				maxGap = gap;
+				if (outAxis) {
+					*outAxis = axis;
 				}
 			}
+		};
+
+		for (int i = 0; i < nrOfAxes1; i++) {
+			testAxis(axes1[i]);
 		}
 
-		return timeFirst;
+		for (int i = 0; i < nrOfAxes2; i++) {
+			testAxis(axes2[i]);
+		}
+
+		// Edges of the first shape are along its axes, which holds for boxes
+		for (int i = 0; i < nrOfAxes1; i++) {
+			for (int j = 0; j < nrOfEdges2; j++) {
+				glm::vec3 axis = glm::cross(axes1[i], edges2[j]);
+				float length2 = glm::length2(axis);
+				if (length2 > 0.0001f) {
+					testAxis(axis / glm::sqrt(length2));
+				}
+			}
+		}
+
+		return maxGap;
 	}
 
 	float Intersection::RayWithAabb(const glm::vec3& rayStart, const glm::vec3& rayVec, const glm::vec3& aabbPos, const glm::vec3& aabbHalfSize, glm::vec3* intersectionAxis) {
@@ -5,21 +5,48 @@
 
 namespace Scuffed {
 
+	class Box;
 	class Shape;
+	class Vec3Span;
 
 	class Intersection {
 	public:
+		// Up to size triangles in SoA form, for testing a box against many triangles at once
+		struct TrianglePacket {
+			static const int size = 8;
+
+			int count = 0;
+			alignas(32) float vertices[3][3][size]; // [vertex][x, y, z][triangle]
+			alignas(32) float edges[3][3][size]; // Same as Triangle::getEdges
+			alignas(32) float normals[3][size]; // Same as Triangle::getNormals
+
+			void add(Shape* triangle);
+			void add(const glm::vec3 triangleVertices[3], const glm::vec3 triangleEdges[3], const glm::vec3& normal);
+			glm::vec3 getVertex(int triangle, int vertex) const;
+		};
+
 		static float dot(const glm::vec3& v1, const glm::vec3& v2);
 
 		// ----SAT functions----
-		static float projectionOverlapTest(const glm::vec3& testVec, const std::vector<glm::vec3>& vertices1, const std::vector<glm::vec3>& vertices2, bool &invertAxis);
+		static float projectionOverlapTest(const glm::vec3& testVec, const Vec3Span& vertices1, const Vec3Span& vertices2, bool &invertAxis);
 		static bool SAT(Shape* shape1, Shape* shape2);
-		static std::vector<glm::vec3> getManifold(const glm::vec3& testVec, const std::vector<glm::vec3>& vertices1, const std::vector<glm::vec3>& vertices2);
+		static std::vector<glm::vec3> getManifold(const glm::vec3& testVec, const Vec3Span& vertices1, const Vec3Span& vertices2);
 		static bool SAT(Shape* shape1, Shape* shape2, glm::vec3* intersectionAxis, float* intersectionDepth); // Allways returns the intersection axis pointing from shape2 towards shape1
 		static bool SAT(Shape* shape1, Shape* shape2, std::vector<glm::vec3>& manifold);
 
-		static bool continousOverlapTest(const glm::vec3& testVec, const std::vector<glm::vec3>& vertices1, const std::vector<glm::vec3>& vertices2, const glm::vec3& relativeVel, float& timeFirst, float& timeLast, const float timeMax);
+		static bool continousOverlapTest(const glm::vec3& testVec, const Vec3Span& vertices1, const Vec3Span& vertices2, const glm::vec3& relativeVel, float& timeFirst, float& timeLast, const float timeMax);
 		static float continousSAT(Shape* shape1, Shape* shape2, const glm::vec3& vel1, const glm::vec3& vel2, const float dt);
+		// Tests the box against all triangles in the packet at once. Each time is the same as continousSAT(box, triangle, ...) gives
+		static void continousSAT(Box* box, const TrianglePacket& triangles, const glm::vec3& vel1, const glm::vec3& vel2, const float dt, float* outTimes);
+		static float continousAABB(const glm::vec3& min1, const glm::vec3& max1, const glm::vec3& min2, const glm::vec3& max2, const glm::vec3& vel1, const glm::vec3& vel2, const float dt); // Axis aligned boxes given as min and max corners
+		// Time when a box turning around pivot with angularVel (axis times radians per second) while moving with vel1 first touches a shape moving with vel2. -1 if it doesn't within maxTime, 0 if they already touch.
+		// Uses conservative advancement, stepping forward by the distance between the shapes over the fastest any corner of the box can approach, so the box can't turn through thin shapes.
+		// outSafeTime is how far the box can move without touching the shape. It is the returned time on a hit and INFINITY on a miss. When the steps run out before the shapes touch -1 is returned, and outSafeTime is how far the steps got
+		static float conservativeAdvancement(Box* box, const glm::vec3& pivot, const glm::vec3& angularVel, Shape* shape, const glm::vec3& vel1, const glm::vec3& vel2, const float maxTime, float& outSafeTime);
+		// Lower bound of the distance between a box and a triangle given like in Mesh::TriangleData, 0 or less if they intersect
+		static float separation(Box* box, const glm::vec3* triangleVertices, const glm::vec3* triangleEdges, const glm::vec3& triangleNormal);
+		// The axis a box and a box or triangle are furthest apart along, or overlap the least along if they intersect. For shapes that touch it is the contact normal, pointing either way
+		static glm::vec3 separatingAxis(Box* box, Shape* shape);
 		// ---------------------
 
 		static float RayWithAabb(const glm::vec3& rayStart, const glm::vec3& rayVec, const glm::vec3& aabbPos, const glm::vec3& aabbHalfSize, glm::vec3* intersectionAxis = nullptr);
@@ -31,6 +58,15 @@ namespace Scuffed {
 		Intersection() {};
 		~Intersection() {};
 
+		friend struct SatKernels;
+
+		static bool continousIntervalTest(const float min1, const float max1, const float min2, const float max2, const float speed, float& timeFirst, float& timeLast, const float timeMax);
+		// Largest gap between the projections of two vertex sets along the given axes and the cross products of the edges. Never more than the distance between the shapes, 0 or less if they intersect.
+		// outAxis is set to the axis of the gap if given
+		static float separatingDistance(const glm::vec3* vertices1, const int nrOfVertices1, const glm::vec3* axes1, const int nrOfAxes1, const glm::vec3* vertices2, const int nrOfVertices2, const glm::vec3* axes2, const int nrOfAxes2, const glm::vec3* edges2, const int nrOfEdges2, glm::vec3* outAxis = nullptr);
+		// Face normals and edges of a box or triangle for separatingDistance. Boxes have opposite normals next to each other and use them as edges as well
+		static void getSeparatingAxes(Shape* shape, glm::vec3* outAxes, int& outNrOfAxes, glm::vec3* outEdges);
+
 		static bool FrustumPlaneWithAabb(const glm::vec3& planeNormal, const float planeDistance, const glm::vec3* aabbCorners);
 		//static bool FrustumWithAabb(const Frustum& frustum, const glm::vec3* aabbCorners);
 
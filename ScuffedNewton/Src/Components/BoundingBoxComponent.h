@@ -11,6 +11,7 @@ namespace Scuffed {
 		BoundingBoxComponent();
 		~BoundingBoxComponent();
 		static std::string ID;
+		static const int TYPE = Components::BoundingBoxComponent;
 
 		virtual Box* getBoundingBox() const;
 
@@ -12,6 +12,7 @@ namespace Scuffed {
 		bool allowSimpleCollision; //Flag to let things collide with the entity's bounding box instead of mesh
 
 		static std::string ID;
+		static const int TYPE = Components::CollidableComponent;
 	};
 
 }
\ No newline at end of file
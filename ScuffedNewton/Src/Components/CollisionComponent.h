@@ -1,6 +1,6 @@
 #pragma once
 #include "Component.h"
-#include "../DataStructures/Octree.h"
+#include "../DataStructures/Broadphase.h"
 
 namespace Scuffed {
 
@@ -14,10 +14,12 @@ namespace Scuffed {
 		bool onGround;
 		bool doSimpleCollisions;
 
-		std::vector<Octree::CollisionInfo> collisions; //Contains the info for current collisions
+		std::vector<Broadphase::CollisionInfo> collisions; //Contains the info for current collisions
 		std::vector<glm::vec3> manifolds;
+		std::vector<Broadphase::CachedTriangles> contactCache; //Kept between updates, entries not used during an update are removed in the next
 
 		static std::string ID;
+		static const int TYPE = Components::CollisionComponent;
 	};
 
 }
\ No newline at end of file
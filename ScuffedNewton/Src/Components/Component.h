@@ -1,8 +1,27 @@
 #pragma once
 
 #include <string>
+#include <bitset>
+
 namespace Scuffed {
 
+	namespace Components {
+		enum types {
+			BoundingBoxComponent,
+			CollidableComponent,
+			CollisionComponent,
+			MovementComponent,
+			MeshComponent,
+			SpeedLimitComponent,
+			TransformComponent,
+			NUMBER_OF_TYPES
+		}; // Change in switch cases in entity virtual functions and in ComponentRegistry if this changes
+	}
+
+	// One bit per component type, indexed by the component's TYPE.
+	// Used as entity signatures and as system requirements so matching an entity to a system is a single AND
+	typedef std::bitset<Components::NUMBER_OF_TYPES> ComponentMask;
+
 	class Component {
 	public:
 		Component() {};
@@ -16,6 +16,7 @@ namespace Scuffed {
 		Mesh* mesh = nullptr;
 
 		static std::string ID;
+		static const int TYPE = Components::MeshComponent;
 		
 	private:
 		bool m_hasChanged;
@@ -9,6 +9,7 @@ namespace Scuffed {
 		velocity = glm::vec3(0.0f);
 		relVel = glm::vec3(0.0f);
 		rotation = glm::quat({ 0.f, 0.f, 0.f });
+		angularVelocity = glm::vec3(0.f);
 		constantAcceleration = glm::vec3(0.f);
 		accelerationToAdd = glm::vec3(0.0f);
 
@@ -18,6 +19,9 @@ namespace Scuffed {
 		airDrag = 1.0f;
 
 		updateableDt = 0.0f;
+
+		restingTime = 0.f;
+		sleeping = false;
 	}
 
 	MovementComponent::~MovementComponent() {
@@ -12,6 +12,7 @@ namespace Scuffed {
 		glm::vec3 velocity;
 		glm::vec3 relVel;
 		glm::quat rotation;
+		glm::vec3 angularVelocity; // Axis times radians per second, turning around the transform's center. Unlike rotation it is swept by the collision system
 		glm::vec3 constantAcceleration;
 		glm::vec3 accelerationToAdd;
 
@@ -22,7 +23,11 @@ namespace Scuffed {
 
 		float updateableDt;
 
+		float restingTime; // How long the entity has moved slower than the scene's sleep speed
+		bool sleeping; // Set by the scene. Sleeping entities are skipped by the systems moving them until their island is woken
+
 		static std::string ID;
+		static const int TYPE = Components::MovementComponent;
 	};
 
 }
\ No newline at end of file
@@ -11,6 +11,7 @@ namespace Scuffed {
 		float maxSpeed;
 		float normalMaxSpeed;
 		static std::string ID;
+		static const int TYPE = Components::SpeedLimitComponent;
 	};
 
 }
\ No newline at end of file
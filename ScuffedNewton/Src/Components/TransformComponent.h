@@ -13,6 +13,7 @@ namespace Scuffed {
 		~TransformComponent();
 
 		static std::string ID;
+		static const int TYPE = Components::TransformComponent;
 	};
 
 }
\ No newline at end of file
@@ -0,0 +1,448 @@
+#include "../pch.h"
+
+#include "AabbTree.h"
+#include "../Calculations/Intersection.h"
+#include "../DataTypes/Entity.h"
+#include "../Components/Components.h"
+#include "../Shapes/Box.h"
+#include "../Shapes/Ray.h"
+
+namespace Scuffed {
+
+	AabbTree::AabbTree() {
+		m_root = -1;
+		m_freeNodes = -1;
+		m_fatMargin = 0.2f;
+	}
+
+	AabbTree::~AabbTree() {
+
+	}
+
+	int AabbTree::allocateNode() {
+		int node;
+		if (m_freeNodes >= 0) {
+			node = m_freeNodes;
+			m_freeNodes = m_nodes[node].parent;
+		}
+		else {
+			node = (int)m_nodes.size();
+			m_nodes.emplace_back();
+		}
+
+		m_nodes[node] = Node();
+		return node;
+	}
+
+	void AabbTree::freeNode(int node) {
+		m_nodes[node].parent = m_freeNodes;
+		m_nodes[node].height = -1;
+		m_nodes[node].entity = nullptr;
+		m_freeNodes = node;
+	}
+
+	float AabbTree::surfaceArea(const glm::vec3& min, const glm::vec3& max) {
+		glm::vec3 size = max - min;
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	void AabbTree::setFatBox(int leaf) {
+		Node& node = m_nodes[leaf];
+		getAabb(node.entity->getComponent<BoundingBoxComponent>()->getBoundingBox(), node.min, node.max);
+		node.min -= glm::vec3(m_fatMargin);
+		node.max += glm::vec3(m_fatMargin);
+	}
+
+	void AabbTree::insertLeaf(int leaf) {
+		if (m_root < 0) {
+			m_root = leaf;
+			m_nodes[leaf].parent = -1;
+			return;
+		}
+
+		// Find the best sibling by walking down the cheapest path, the cost being the added surface area
+		const glm::vec3 leafMin = m_nodes[leaf].min;
+		const glm::vec3 leafMax = m_nodes[leaf].max;
+
+		int index = m_root;
+		while (m_nodes[index].child1 >= 0) {
+			const Node& node = m_nodes[index];
+
+			float area = surfaceArea(node.min, node.max);
+			float combinedArea = surfaceArea(glm::min(node.min, leafMin), glm::max(node.max, leafMax));
+
+			// Cost of making a new parent for this node and the new leaf
+			float cost = 2.0f * combinedArea;
+
+			// Minimum cost of pushing the leaf further down the tree
+			float inheritanceCost = 2.0f * (combinedArea - area);
+
+			float childCosts[2];
+			int children[2] = { node.child1, node.child2 };
+			for (int i = 0; i < 2; i++) {
+				const Node& child = m_nodes[children[i]];
+				float childCombinedArea = surfaceArea(glm::min(child.min, leafMin), glm::max(child.max, leafMax));
+				if (child.child1 < 0) {
+					childCosts[i] = childCombinedArea + inheritanceCost;
+				}
+				else {
+					childCosts[i] = childCombinedArea - surfaceArea(child.min, child.max) + inheritanceCost;
+				}
+			}
+
+			if (cost < childCosts[0] && cost < childCosts[1]) {
+				break;
+			}
+
+			index = childCosts[0] < childCosts[1] ? children[0] : children[1];
+		}
+
+		int sibling = index;
+
+		// Create a new parent for the sibling and the leaf. Can reallocate m_nodes so no references are held across this
+		int oldParent = m_nodes[sibling].parent;
+		int newParent = allocateNode();
+
+		Node& parentNode = m_nodes[newParent];
+		parentNode.parent = oldParent;
+		parentNode.min = glm::min(m_nodes[sibling].min, leafMin);
+		parentNode.max = glm::max(m_nodes[sibling].max, leafMax);
+		parentNode.height = m_nodes[sibling].height + 1;
+		parentNode.child1 = sibling;
+		parentNode.child2 = leaf;
+
+		if (oldParent >= 0) {
+			if (m_nodes[oldParent].child1 == sibling) {
+				m_nodes[oldParent].child1 = newParent;
+			}
+			else {
+				m_nodes[oldParent].child2 = newParent;
+			}
+		}
+		else {
+			m_root = newParent;
+		}
+		m_nodes[sibling].parent = newParent;
+		m_nodes[leaf].parent = newParent;
+
+		refitAncestors(m_nodes[leaf].parent);
+	}
+
+	void AabbTree::removeLeaf(int leaf) {
+		if (leaf == m_root) {
+			m_root = -1;
+			return;
+		}
+
+		int parent = m_nodes[leaf].parent;
+		int grandParent = m_nodes[parent].parent;
+		int sibling = m_nodes[parent].child1 == leaf ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+		// The sibling takes the place of the parent
+		if (grandParent >= 0) {
+			if (m_nodes[grandParent].child1 == parent) {
+				m_nodes[grandParent].child1 = sibling;
+			}
+			else {
+				m_nodes[grandParent].child2 = sibling;
+			}
+			m_nodes[sibling].parent = grandParent;
+			freeNode(parent);
+
+			refitAncestors(grandParent);
+		}
+		else {
+			m_root = sibling;
+			m_nodes[sibling].parent = -1;
+			freeNode(parent);
+		}
+
+		m_nodes[leaf].parent = -1;
+	}
+
+	void AabbTree::refitAncestors(int node) {
+		// Walk back up the tree, balancing and fixing the boxes and heights
+		while (node >= 0) {
+			node = balance(node);
+
+			Node& current = m_nodes[node];
+			const Node& child1 = m_nodes[current.child1];
+			const Node& child2 = m_nodes[current.child2];
+
+			current.height = 1 + glm::max(child1.height, child2.height);
+			current.min = glm::min(child1.min, child2.min);
+			current.max = glm::max(child1.max, child2.max);
+
+			node = current.parent;
+		}
+	}
+
+	int AabbTree::balance(int iA) {
+		// Rotates the higher child of A up if the heights of A's children differ by more than one. Returns the new root of the subtree
+		Node& A = m_nodes[iA];
+		if (A.child1 < 0 || A.height < 2) {
+			return iA;
+		}
+
+		int iB = A.child1;
+		int iC = A.child2;
+		Node& B = m_nodes[iB];
+		Node& C = m_nodes[iC];
+
+		int heightDifference = C.height - B.height;
+
+		if (heightDifference > 1) { // Rotate C up
+			int iF = C.child1;
+			int iG = C.child2;
+			Node& F = m_nodes[iF];
+			Node& G = m_nodes[iG];
+
+			// Swap A and C
+			C.child1 = iA;
+			C.parent = A.parent;
+			A.parent = iC;
+
+			// A's old parent should point to C
+			if (C.parent >= 0) {
+				if (m_nodes[C.parent].child1 == iA) {
+					m_nodes[C.parent].child1 = iC;
+				}
+				else {
+					m_nodes[C.parent].child2 = iC;
+				}
+			}
+			else {
+				m_root = iC;
+			}
+
+			// Keep the higher of F and G under C
+			if (F.height > G.height) {
+				C.child2 = iF;
+				A.child2 = iG;
+				G.parent = iA;
+				A.min = glm::min(B.min, G.min);
+				A.max = glm::max(B.max, G.max);
+				C.min = glm::min(A.min, F.min);
+				C.max = glm::max(A.max, F.max);
+
+				A.height = 1 + glm::max(B.height, G.height);
+				C.height = 1 + glm::max(A.height, F.height);
+			}
+			else {
+				C.child2 = iG;
+				A.child2 = iF;
+				F.parent = iA;
+				A.min = glm::min(B.min, F.min);
+				A.max = glm::max(B.max, F.max);
+				C.min = glm::min(A.min, G.min);
+				C.max = glm::max(A.max, G.max);
+
+				A.height = 1 + glm::max(B.height, F.height);
+				C.height = 1 + glm::max(A.height, G.height);
+			}
+
+			return iC;
+		}
+
+		if (heightDifference < -1) { // Rotate B up
+			int iD = B.child1;
+			int iE = B.child2;
+			Node& D = m_nodes[iD];
+			Node& E = m_nodes[iE];
+
+			// Swap A and B
+			B.child1 = iA;
+			B.parent = A.parent;
+			A.parent = iB;
+
+			// A's old parent should point to B
+			if (B.parent >= 0) {
+				if (m_nodes[B.parent].child1 == iA) {
+					m_nodes[B.parent].child1 = iB;
+				}
+				else {
+					m_nodes[B.parent].child2 = iB;
+				}
+			}
+			else {
+				m_root = iB;
+			}
+
+			// Keep the higher of D and E under B
+			if (D.height > E.height) {
+				B.child2 = iD;
+				A.child1 = iE;
+				E.parent = iA;
+				A.min = glm::min(C.min, E.min);
+				A.max = glm::max(C.max, E.max);
+				B.min = glm::min(A.min, D.min);
+				B.max = glm::max(A.max, D.max);
+
+				A.height = 1 + glm::max(C.height, E.height);
+				B.height = 1 + glm::max(A.height, D.height);
+			}
+			else {
+				B.child2 = iE;
+				A.child1 = iD;
+				D.parent = iA;
+				A.min = glm::min(C.min, D.min);
+				A.max = glm::max(C.max, D.max);
+				B.min = glm::min(A.min, E.min);
+				B.max = glm::max(A.max, E.max);
+
+				A.height = 1 + glm::max(C.height, D.height);
+				B.height = 1 + glm::max(A.height, E.height);
+			}
+
+			return iB;
+		}
+
+		return iA;
+	}
+
+	void AabbTree::getNextContinousCollisionRec(Entity* entity, Box* entityBoundingBox, const glm::vec3& entityMin, const glm::vec3& entityMax, const glm::vec3& entityVel, int currentNode, std::vector<CollisionInfo>& collisionInfo, float& collisionTime, std::vector<CollisionInfo>& zeroDistances, const float& dt, const bool doSimpleCollisions) {
+		const Node& node = m_nodes[currentNode];
+
+		// Early exit if Bounding box doesn't collide with the current node
+		float tempCollisionTime = Intersection::continousAABB(entityMin, entityMax, node.min, node.max, entityVel, glm::vec3(0.f), dt);
+		if (tempCollisionTime < 0.f || tempCollisionTime > collisionTime) {
+			return;
+		}
+
+		if (node.child1 < 0) {
+			collideWithEntity(entity, entityBoundingBox, entityVel, node.entity, collisionInfo, collisionTime, zeroDistances, dt, doSimpleCollisions);
+		}
+		else {
+			getNextContinousCollisionRec(entity, entityBoundingBox, entityMin, entityMax, entityVel, node.child1, collisionInfo, collisionTime, zeroDistances, dt, doSimpleCollisions);
+			getNextContinousCollisionRec(entity, entityBoundingBox, entityMin, entityMax, entityVel, node.child2, collisionInfo, collisionTime, zeroDistances, dt, doSimpleCollisions);
+		}
+	}
+
+	void AabbTree::getEntitiesInAabbRec(const glm::vec3& min, const glm::vec3& max, int currentNode, std::vector<Entity*>& outEntities) {
+		const Node& node = m_nodes[currentNode];
+		if (!aabbsOverlap(min, max, node.min, node.max)) {
+			return;
+		}
+
+		if (node.child1 < 0) {
+			outEntities.push_back(node.entity);
+		}
+		else {
+			getEntitiesInAabbRec(min, max, node.child1, outEntities);
+			getEntitiesInAabbRec(min, max, node.child2, outEntities);
+		}
+	}
+
+	void AabbTree::getRayIntersectionRec(Ray* ray, int currentNode, RayIntersectionInfo* outIntersectionData, Entity* ignoreThis, const bool doSimpleIntersections) {
+		const Node& node = m_nodes[currentNode];
+		glm::vec3& rayDir = ray->getNormals()[0];
+		const glm::vec3& rayStart = ray->getVertices()[0];
+
+		// Early exit if ray doesn't intersect with the current node closer than the closest hit
+		float nodeIntersectionDistance = Intersection::continousAABB(rayStart, rayStart, node.min, node.max, rayDir, glm::vec3(0.f), INFINITY);
+		if (nodeIntersectionDistance < 0.0f || (outIntersectionData->closestHit >= 0.0f && nodeIntersectionDistance > outIntersectionData->closestHit)) {
+			return;
+		}
+
+		if (node.child1 < 0) {
+			intersectRayWithEntity(ray, node.entity, outIntersectionData, ignoreThis, doSimpleIntersections);
+		}
+		else {
+			getRayIntersectionRec(ray, node.child1, outIntersectionData, ignoreThis, doSimpleIntersections);
+			getRayIntersectionRec(ray, node.child2, outIntersectionData, ignoreThis, doSimpleIntersections);
+		}
+	}
+
+	void AabbTree::addEntity(Entity* newEntity) {
+		if (hasEntity(newEntity)) {
+			// Already in the tree
+			return;
+		}
+
+		int leaf = allocateNode();
+		m_nodes[leaf].entity = newEntity;
+		setFatBox(leaf);
+		insertLeaf(leaf);
+
+		m_leafIndices.set(newEntity->getId(), leaf);
+	}
+
+	void AabbTree::removeEntity(Entity* entityToRemove) {
+		int id = entityToRemove->getId();
+		int leaf = m_leafIndices.get(id);
+		if (leaf < 0) {
+			return;
+		}
+
+		removeLeaf(leaf);
+		freeNode(leaf);
+		m_leafIndices.remove(id);
+	}
+
+	bool AabbTree::hasEntity(Entity* entity) const {
+		return m_leafIndices.get(entity->getId()) >= 0;
+	}
+
+	void AabbTree::update(const float /*dt*/) {
+		std::vector<int> leavesToReinsert;
+
+		for (size_t i = 0; i < m_nodes.size(); i++) {
+			const Node& node = m_nodes[i];
+			if (node.height != 0 || !node.entity) {
+				continue;
+			}
+
+			if (hasChanged(node.entity)) { //Entity has changed
+				// Only move the leaf if the entity has left its fat box
+				glm::vec3 min, max;
+				getAabb(node.entity->getComponent<BoundingBoxComponent>()->getBoundingBox(), min, max);
+				if (glm::any(glm::lessThan(min, node.min)) || glm::any(glm::greaterThan(max, node.max))) {
+					leavesToReinsert.push_back((int)i);
+				}
+			}
+		}
+
+		for (int leaf : leavesToReinsert) {
+			removeLeaf(leaf);
+			setFatBox(leaf);
+			insertLeaf(leaf);
+		}
+	}
+
+	void AabbTree::beginConcurrentQueries() {
+		// Warm the lazily updated data of everything in the tree so queries only read
+		for (auto& node : m_nodes) {
+			if (node.height == 0 && node.entity) {
+				warmCachedData(node.entity);
+			}
+		}
+		m_concurrentQueries = true;
+	}
+
+	void AabbTree::getNextContinousCollision(Entity* entity, Box* entityBoundingBox, const glm::vec3& entityVel, std::vector<CollisionInfo>& outCollisionInfo, float& collisionTime, std::vector<CollisionInfo>& zeroDistances, const float& dt, const bool doSimpleCollisions, const bool /*checkBackfaces*/) {
+		if (m_root < 0) {
+			return;
+		}
+
+		glm::vec3 entityMin, entityMax;
+		getAabb(entityBoundingBox, entityMin, entityMax);
+
+		getNextContinousCollisionRec(entity, entityBoundingBox, entityMin, entityMax, entityVel, m_root, outCollisionInfo, collisionTime, zeroDistances, dt, doSimpleCollisions);
+	}
+
+	void AabbTree::getEntitiesInAabb(const glm::vec3& min, const glm::vec3& max, std::vector<Entity*>& outEntities) {
+		if (m_root >= 0) {
+			getEntitiesInAabbRec(min, max, m_root, outEntities);
+		}
+	}
+
+	void AabbTree::getRayIntersection(const glm::vec3& rayStart, const glm::vec3& rayDir, RayIntersectionInfo* outIntersectionData, Entity* ignoreThis, const bool doSimpleIntersections, const bool /*checkBackfaces*/) {
+		if (m_root < 0) {
+			return;
+		}
+
+		Ray ray(rayStart, rayDir);
+		getRayIntersectionRec(&ray, m_root, outIntersectionData, ignoreThis, doSimpleIntersections);
+	}
+
+}
\ No newline at end of file
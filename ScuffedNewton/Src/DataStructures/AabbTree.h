@@ -0,0 +1,69 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "Broadphase.h"
+
+namespace Scuffed {
+
+	class Entity;
+	class Ray;
+
+	// Dynamic bounding volume tree. Each entity is a leaf with an enlarged ("fat") axis aligned box,
+	// so small movements don't change the tree. Internal nodes contain both children and the tree is kept balanced with rotations
+	class AabbTree : public Broadphase {
+	private:
+		struct Node {
+			glm::vec3 min = glm::vec3(0.f);
+			glm::vec3 max = glm::vec3(0.f);
+			int parent = -1; // Next free node when the node is not used
+			int child1 = -1; // -1 for leaves
+			int child2 = -1;
+			int height = 0; // 0 for leaves, -1 when the node is not used
+			Entity* entity = nullptr;
+		};
+
+		std::vector<Node> m_nodes;
+		int m_root;
+		int m_freeNodes; // First node in the free list
+		IdMap m_leafIndices; // Entity id -> leaf in m_nodes, -1 if the entity is not in the tree
+
+		float m_fatMargin; // How much the leaf boxes are enlarged in every direction
+
+		int allocateNode();
+		void freeNode(int node);
+
+		void insertLeaf(int leaf);
+		void removeLeaf(int leaf);
+		int balance(int node);
+		void refitAncestors(int node);
+		void setFatBox(int leaf);
+
+		static float surfaceArea(const glm::vec3& min, const glm::vec3& max);
+
+		void getNextContinousCollisionRec(Entity* entity, Box* entityBoundingBox, const glm::vec3& entityMin, const glm::vec3& entityMax, const glm::vec3& entityVel, int currentNode, std::vector<CollisionInfo>& collisionInfo, float& collisionTime, std::vector<CollisionInfo>& zeroDistances, const float& dt, const bool doSimpleCollisions);
+		void getEntitiesInAabbRec(const glm::vec3& min, const glm::vec3& max, int currentNode, std::vector<Entity*>& outEntities);
+		void getRayIntersectionRec(Ray* ray, int currentNode, RayIntersectionInfo* outIntersectionData, Entity* ignoreThis, const bool doSimpleIntersections);
+
+	public:
+		AabbTree();
+		virtual ~AabbTree();
+
+		virtual void addEntity(Entity* newEntity);
+		virtual void removeEntity(Entity* entityToRemove);
+		virtual bool hasEntity(Entity* entity) const;
+
+		virtual void update(const float dt);
+
+		virtual void beginConcurrentQueries();
+
+		using Broadphase::getNextContinousCollision;
+		virtual void getNextContinousCollision(Entity* entity, Box* entityBoundingBox, const glm::vec3& entityVel, std::vector<CollisionInfo>& outCollisionInfo, float& collisionTime, std::vector<CollisionInfo>& zeroDistances, const float& dt = INFINITY, const bool doSimpleCollisions = false, const bool checkBackfaces = false);
+		virtual void getRayIntersection(const glm::vec3& rayStart, const glm::vec3& rayDir, RayIntersectionInfo* outIntersectionData, Entity* ignoreThis = nullptr, const bool doSimpleIntersections = false, const bool checkBackfaces = false);
+
+	protected:
+		virtual void getEntitiesInAabb(const glm::vec3& min, const glm::vec3& max, std::vector<Entity*>& outEntities);
+	};
+
+}
\ No newline at end of file
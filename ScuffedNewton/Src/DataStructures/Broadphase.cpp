@@ -0,0 +1,651 @@
+#include "../pch.h"
+
+#include <algorithm>
+
+#include "Broadphase.h"
+#include "../Calculations/Intersection.h"
+#include "../DataTypes/Entity.h"
+#include "../DataTypes/Mesh.h"
+#include "../Components/Components.h"
+#include "../Shapes/Box.h"
+#include "../Shapes/Triangle.h"
+#include "../Shapes/Shape.h"
+#include "../Shapes/Ray.h"
+
+namespace Scuffed {
+
+	namespace {
+		// Lists filled by the queries, one set per thread so queries can run concurrently. Kept between queries to reuse their memory
+		struct QueryBuffers {
+			std::vector<Entity*> entities;
+			std::vector<int> triangles;
+		};
+		thread_local QueryBuffers t_queryBuffers;
+	}
+
+	void Broadphase::CollisionInfo::setTriangle(Entity* e, int meshTriangle, const glm::vec3& v1, const glm::vec3& v2, const glm::vec3& v3) {
+		entity = e;
+		shapeType = ShapeTypes::Triangle;
+		triangle = meshTriangle;
+		vertices[0] = v1;
+		vertices[1] = v2;
+		vertices[2] = v3;
+	}
+
+	void Broadphase::CollisionInfo::setBox(Entity* e, Box* box) {
+		entity = e;
+		shapeType = ShapeTypes::Box;
+		triangle = -1;
+
+		const Vec3Span boxVertices = box->getVertices();
+		const Vec3Span boxNormals = box->getNormals();
+		for (int i = 0; i < 8; i++) {
+			vertices[i] = boxVertices[i];
+		}
+		for (int i = 0; i < 6; i++) {
+			normals[i] = boxNormals[i];
+		}
+	}
+
+	Shape* Broadphase::CollisionInfo::getShape(Triangle& triangleShape, Box& boxShape) const {
+		if (shapeType == ShapeTypes::Triangle) {
+			triangleShape.setData(vertices[0], vertices[1], vertices[2]);
+			return &triangleShape;
+		}
+
+		boxShape.setData(vertices, normals);
+		return &boxShape;
+	}
+
+	Broadphase::Broadphase() {
+		m_concurrentQueries = false;
+		m_contactCacheMargin = 0.25f;
+	}
+
+	Broadphase::~Broadphase() {
+
+	}
+
+	void Broadphase::addEntities(std::vector<Entity*>* newEntities) {
+		for (unsigned int i = 0; i < newEntities->size(); i++) {
+			addEntity(newEntities->at(i));
+		}
+	}
+
+	void Broadphase::removeEntities(std::vector<Entity*> entitiesToRemove) {
+		for (unsigned int i = 0; i < entitiesToRemove.size(); i++) {
+			removeEntity(entitiesToRemove[i]);
+		}
+	}
+
+	void Broadphase::endConcurrentQueries() {
+		m_concurrentQueries = false;
+	}
+
+	void Broadphase::getNextContinousCollision(Entity* entity, std::vector<CollisionInfo>& outCollisionInfo, float& collisionTime, std::vector<CollisionInfo>& zeroDistances, const float& dt, const bool doSimpleCollisions, const bool checkBackfaces) {
+		MovementComponent* movComp = entity->getComponent<MovementComponent>();
+
+		glm::vec3 entityVel(0.f);
+
+		if (movComp) {
+			entityVel = movComp->velocity;
+		}
+
+		getNextContinousCollision(entity, entity->getComponent<BoundingBoxComponent>()->getBoundingBox(), entityVel, outCollisionInfo, collisionTime, zeroDistances, dt, doSimpleCollisions, checkBackfaces);
+	}
+
+	void Broadphase::getReach(Box* boundingBox, const glm::vec3& velocity, const float dt, glm::vec3& outMin, glm::vec3& outMax) {
+		getAabb(boundingBox, outMin, outMax);
+
+		// Small margin for the nudges the collision handling does after each collision
+		glm::vec3 distance(glm::length(velocity) * dt + 0.01f);
+		outMin -= distance;
+		outMax += distance;
+	}
+
+	void Broadphase::getReach(Box* boundingBox, const glm::vec3& velocity, const glm::vec3& pivot, const glm::vec3& angularVelocity, const float dt, glm::vec3& outMin, glm::vec3& outMax) {
+		getReach(boundingBox, velocity, dt, outMin, outMax);
+
+		// A corner turning by an angle moves at most the angle times its distance to the pivot, and never more than across the circle it turns on
+		float radius = 0.f;
+		for (const auto& vertex : boundingBox->getVertices()) {
+			radius = glm::max(radius, glm::length(vertex - pivot));
+		}
+		glm::vec3 distance(glm::min(glm::length(angularVelocity) * dt, 2.f) * radius);
+		outMin -= distance;
+		outMax += distance;
+	}
+
+	void Broadphase::getPairs(const std::vector<Entity*>& movingEntities, const std::vector<glm::vec3>& reachMins, const std::vector<glm::vec3>& reachMaxes, std::vector<EntityPair>& outPairs) {
+		setMovingEntityIndices(movingEntities);
+		size_t firstPair = outPairs.size();
+
+		// Entities standing still can only be reached by the entity itself, so the search is only as large as its own reach
+		std::vector<Entity*>& foundEntities = t_queryBuffers.entities;
+		for (size_t i = 0; i < movingEntities.size(); i++) {
+			foundEntities.clear();
+			getEntitiesInAabb(reachMins[i], reachMaxes[i], foundEntities);
+
+			for (Entity* other : foundEntities) {
+				if (getMovingEntityIndex(other) < 0) {
+					testPair(movingEntities, reachMins, reachMaxes, (int)i, other, outPairs);
+				}
+			}
+		}
+
+		// Two moving entities meet if their reaches overlap. Sort the reaches along x and only compare the ones overlapping along it
+		m_reachOrder.resize(movingEntities.size());
+		m_isInBroadphase.resize(movingEntities.size());
+		for (size_t i = 0; i < movingEntities.size(); i++) {
+			m_reachOrder[i] = (int)i;
+			m_isInBroadphase[i] = hasEntity(movingEntities[i]);
+		}
+		std::sort(m_reachOrder.begin(), m_reachOrder.end(), [&](int index1, int index2) {
+			return reachMins[index1].x < reachMins[index2].x;
+		});
+
+		for (size_t i = 0; i < m_reachOrder.size(); i++) {
+			const int index1 = m_reachOrder[i];
+			for (size_t j = i + 1; j < m_reachOrder.size() && reachMins[m_reachOrder[j]].x <= reachMaxes[index1].x; j++) {
+				const int index2 = m_reachOrder[j];
+				if (!aabbsOverlap(reachMins[index1], reachMaxes[index1], reachMins[index2], reachMaxes[index2])) {
+					continue;
+				}
+
+				// The pair is owned by the entity that comes first, unless only the other one can be collided with
+				const int first = glm::min(index1, index2);
+				const int second = glm::max(index1, index2);
+				if (m_isInBroadphase[second]) {
+					outPairs.push_back({ movingEntities[first], movingEntities[second] });
+				}
+				else if (m_isInBroadphase[first]) {
+					outPairs.push_back({ movingEntities[second], movingEntities[first] });
+				}
+			}
+		}
+
+		// The order the pairs are found in depends on the structure, sort them so it doesn't change the collision results
+		std::sort(outPairs.begin() + firstPair, outPairs.end(), [&](const EntityPair& pair1, const EntityPair& pair2) {
+			int index1 = getMovingEntityIndex(pair1.entity1);
+			int index2 = getMovingEntityIndex(pair2.entity1);
+			if (index1 != index2) {
+				return index1 < index2;
+			}
+			return pair1.entity2->getId() < pair2.entity2->getId();
+		});
+
+		clearMovingEntityIndices(movingEntities);
+	}
+
+	void Broadphase::getNextContinousCollisionWithEntities(Entity* entity, Box* entityBoundingBox, const glm::vec3& entityVel, const std::vector<Entity*>& entities, std::vector<CollisionInfo>& outCollisionInfo, float& collisionTime, std::vector<CollisionInfo>& zeroDistances, const float& dt, const bool doSimpleCollisions, const bool /*checkBackfaces*/) {
+		for (Entity* other : entities) {
+			collideWithEntity(entity, entityBoundingBox, entityVel, other, outCollisionInfo, collisionTime, zeroDistances, dt, doSimpleCollisions);
+		}
+	}
+
+	void Broadphase::getNextRotatingCollision(Entity* entity, Box* entityBoundingBox, const glm::vec3& entityVel, const glm::vec3& pivot, const glm::vec3& angularVel, std::vector<CollisionInfo>& outCollisionInfo, float& collisionTime, std::vector<CollisionInfo>& zeroDistances, const float dt, const bool doSimpleCollisions) {
+		glm::vec3 reachMin, reachMax;
+		getReach(entityBoundingBox, entityVel, pivot, angularVel, dt, reachMin, reachMax);
+
+		std::vector<Entity*>& entities = t_queryBuffers.entities;
+		entities.clear();
+		getEntitiesInAabb(reachMin, reachMax, entities);
+
+		// Sorts a time found for a shape the same way collideWithEntity does, returns where to store the shape or nullptr if it isn't needed
+		auto getInfo = [&](float time) -> CollisionInfo* {
+			if (time > 0.f && time < collisionTime) {
+				outCollisionInfo.clear();
+				collisionTime = time;
+				outCollisionInfo.emplace_back();
+				return &outCollisionInfo.back();
+			}
+			else if (time == collisionTime) {
+				outCollisionInfo.emplace_back();
+				return &outCollisionInfo.back();
+			}
+			else if (time == 0.f) {
+				zeroDistances.emplace_back();
+				return &zeroDistances.back();
+			}
+			return nullptr;
+		};
+
+		Triangle triangle(glm::vec3(0.f), glm::vec3(0.f), glm::vec3(0.f));
+		std::vector<int>& triangles = t_queryBuffers.triangles;
+
+		// How far the entity can move before reaching a shape that the advancement ran out of steps for
+		float safeTime = INFINITY;
+		float shapeSafeTime;
+
+		for (Entity* e : entities) {
+			//Don't let an entity collide with itself
+			if (entity->getId() == e->getId()) {
+				continue;
+			}
+
+			Box* otherBoundingBox = e->getComponent<BoundingBoxComponent>()->getBoundingBox();
+			MovementComponent* otherMovComp = e->getComponent<MovementComponent>();
+			glm::vec3 otherEntityVel = otherMovComp ? otherMovComp->velocity : glm::vec3(0.f);
+
+			float time = Intersection::conservativeAdvancement(entityBoundingBox, pivot, angularVel, otherBoundingBox, entityVel, otherEntityVel, dt, shapeSafeTime);
+			// Skip the entity if its bounding box can't be hit before the current collision. Nothing inside the box can be hit before it either
+			if (time < 0.f || time > collisionTime) {
+				if (time < 0.f) {
+					safeTime = glm::min(safeTime, shapeSafeTime);
+				}
+				continue;
+			}
+
+			const MeshComponent* mesh = e->getComponent<MeshComponent>();
+			TransformComponent* transform = e->getComponent<TransformComponent>();
+			const CollidableComponent* collidable = e->getComponent<CollidableComponent>();
+
+			if (mesh && !(doSimpleCollisions && collidable->allowSimpleCollision)) {
+				glm::mat4 transformMatrix(1.0f);
+				glm::mat4 inverseTransformMatrix(1.0f);
+				if (transform) {
+					transformMatrix = m_concurrentQueries ? transform->getMatrixWithoutUpdate() : transform->getMatrixWithUpdate();
+					inverseTransformMatrix = m_concurrentQueries ? transform->getInverseMatrixWithoutUpdate() : transform->getInverseMatrixWithUpdate();
+				}
+
+				// Triangles within the reach in mesh space, grown by how far the mesh moves
+				glm::vec3 meshMovement = glm::abs(otherEntityVel * dt);
+				Box area((reachMax - reachMin) * 0.5f + meshMovement, (reachMax + reachMin) * 0.5f);
+				area.setMatrix(inverseTransformMatrix);
+
+				glm::vec3 zeroVel(0.f);
+				triangles.clear();
+				mesh->mesh->getTrianglesForContinousCollisionTesting(triangles, &area, zeroVel, zeroVel, dt);
+
+				for (int index : triangles) {
+					const Mesh::TriangleData& data = mesh->mesh->getTriangleData(index);
+					triangle.setData(glm::vec3(transformMatrix * glm::vec4(data.vertices[0], 1.0f)), glm::vec3(transformMatrix * glm::vec4(data.vertices[1], 1.0f)), glm::vec3(transformMatrix * glm::vec4(data.vertices[2], 1.0f)));
+
+					const float triangleTime = Intersection::conservativeAdvancement(entityBoundingBox, pivot, angularVel, &triangle, entityVel, otherEntityVel, dt, shapeSafeTime);
+					if (triangleTime < 0.f) {
+						safeTime = glm::min(safeTime, shapeSafeTime);
+					}
+
+					CollisionInfo* info = getInfo(triangleTime);
+					if (info) {
+						const Vec3Span vertices = triangle.getVertices();
+						info->setTriangle(e, index, vertices[0], vertices[1], vertices[2]);
+					}
+				}
+			}
+			else {
+				CollisionInfo* info = getInfo(time);
+				if (info) {
+					info->setBox(e, otherBoundingBox);
+				}
+			}
+		}
+
+		if (safeTime < collisionTime) {
+			// A shape the entity might reach first couldn't be resolved. The entity can only be moved up to it, and the collisions found further away are found again from there
+			collisionTime = safeTime;
+			outCollisionInfo.clear();
+		}
+	}
+
+	bool Broadphase::aabbsOverlap(const glm::vec3& min1, const glm::vec3& max1, const glm::vec3& min2, const glm::vec3& max2) {
+		return min1.x <= max2.x && min2.x <= max1.x &&
+			min1.y <= max2.y && min2.y <= max1.y &&
+			min1.z <= max2.z && min2.z <= max1.z;
+	}
+
+	void Broadphase::setMovingEntityIndices(const std::vector<Entity*>& movingEntities) {
+		for (size_t i = 0; i < movingEntities.size(); i++) {
+			m_movingEntityIndices.set(movingEntities[i]->getId(), (int)i);
+		}
+	}
+
+	void Broadphase::clearMovingEntityIndices(const std::vector<Entity*>& movingEntities) {
+		for (Entity* e : movingEntities) {
+			m_movingEntityIndices.remove(e->getId());
+		}
+	}
+
+	int Broadphase::getMovingEntityIndex(Entity* entity) const {
+		return m_movingEntityIndices.get(entity->getId());
+	}
+
+	void Broadphase::testPair(const std::vector<Entity*>& movingEntities, const std::vector<glm::vec3>& reachMins, const std::vector<glm::vec3>& reachMaxes, int movingIndex, Entity* other, std::vector<EntityPair>& outPairs) {
+		Entity* entity = movingEntities[movingIndex];
+		if (entity == other) {
+			return;
+		}
+
+		int otherIndex = getMovingEntityIndex(other);
+		if (otherIndex >= 0) {
+			if (!aabbsOverlap(reachMins[movingIndex], reachMaxes[movingIndex], reachMins[otherIndex], reachMaxes[otherIndex])) {
+				return;
+			}
+		}
+		else {
+			glm::vec3 otherMin, otherMax;
+			getAabb(other->getComponent<BoundingBoxComponent>()->getBoundingBox(), otherMin, otherMax);
+			if (!aabbsOverlap(reachMins[movingIndex], reachMaxes[movingIndex], otherMin, otherMax)) {
+				return;
+			}
+		}
+
+		outPairs.push_back({ entity, other });
+	}
+
+	bool Broadphase::hasChanged(Entity* entity) {
+		return entity->getComponent<BoundingBoxComponent>()->getBoundingBox()->getChange();
+	}
+
+	void Broadphase::warmCachedData(Entity* entity) {
+		entity->getComponent<BoundingBoxComponent>()->getBoundingBox()->updateCachedData();
+
+		TransformComponent* transform = entity->getComponent<TransformComponent>();
+		if (transform) {
+			transform->getInverseMatrixWithUpdate(); // Updates the matrix as well
+		}
+	}
+
+	void Broadphase::getAabb(Shape* shape, glm::vec3& outMin, glm::vec3& outMax) {
+		outMin = glm::vec3(INFINITY);
+		outMax = glm::vec3(-INFINITY);
+		for (const auto& vertex : shape->getVertices()) {
+			outMin = glm::min(outMin, vertex);
+			outMax = glm::max(outMax, vertex);
+		}
+	}
+
+	Broadphase::CachedTriangles* Broadphase::getTrianglesToTest(Entity* entity, Entity* meshEntity, Mesh* mesh, const glm::mat4& transformMatrix, Box* localBoundingBox, glm::vec3& localVel, glm::vec3& meshVel, const float& dt, std::vector<int>& outTriangles) {
+		// Only the querying entity's own collision component is written, so this is safe during concurrent queries
+		CollisionComponent* collision = entity->getComponent<CollisionComponent>();
+		if (!collision || dt == INFINITY) {
+			mesh->getTrianglesForContinousCollisionTesting(outTriangles, localBoundingBox, localVel, meshVel, dt);
+			return nullptr;
+		}
+
+		// Area the box sweeps through in mesh space
+		glm::vec3 min(INFINITY), max(-INFINITY);
+		for (const auto& vertex : localBoundingBox->getVertices()) {
+			min = glm::min(min, vertex);
+			max = glm::max(max, vertex);
+		}
+		glm::vec3 movedDistance = (localVel - meshVel) * dt;
+		min = glm::min(min, min + movedDistance);
+		max = glm::max(max, max + movedDistance);
+
+		CachedTriangles* cached = nullptr;
+		for (auto& it : collision->contactCache) {
+			if (it.entityId == meshEntity->getId() && it.mesh == mesh) {
+				cached = &it;
+				break;
+			}
+		}
+
+		if (cached && cached->meshVersion == mesh->getVersion() && cached->transform == transformMatrix && glm::all(glm::greaterThanEqual(min, cached->min)) && glm::all(glm::lessThanEqual(max, cached->max))) {
+			// The triangles the box can hit are all in the cached area, and the area holds them in the same order as the octree query would
+			cached->used = true;
+
+			if (cached->hasContacts) {
+				// No point of the box has moved further than its corners since the last full test. If that and the sweep don't cover the distance to the closest other triangle, only the contacts can be reached
+				float moved = 0.f;
+				const Vec3Span vertices = localBoundingBox->getVertices();
+				for (int i = 0; i < 8; i++) {
+					moved = glm::max(moved, glm::length(vertices[i] - cached->vertices[i]));
+				}
+
+				// Kept well above float precision, the test itself has no tolerance
+				const float margin = 0.001f;
+				if (moved + glm::length(localVel - meshVel) * dt + margin < cached->clearance) {
+					outTriangles.insert(outTriangles.end(), cached->contacts.begin(), cached->contacts.end());
+					return nullptr;
+				}
+			}
+
+			outTriangles.insert(outTriangles.end(), cached->triangles.begin(), cached->triangles.end());
+			return cached;
+		}
+
+		if (!cached) {
+			collision->contactCache.emplace_back();
+			cached = &collision->contactCache.back();
+			cached->entityId = meshEntity->getId();
+			cached->mesh = mesh;
+		}
+
+		// Cache a slightly larger area than needed so the box can keep moving for a while before it has to be searched again
+		cached->used = true;
+		cached->meshVersion = mesh->getVersion();
+		cached->transform = transformMatrix;
+		cached->min = min - glm::vec3(m_contactCacheMargin);
+		cached->max = max + glm::vec3(m_contactCacheMargin);
+		cached->triangles.clear();
+
+		Box area((cached->max - cached->min) * 0.5f, (cached->max + cached->min) * 0.5f);
+		glm::vec3 zeroVel(0.f);
+		mesh->getTrianglesForContinousCollisionTesting(cached->triangles, &area, zeroVel, zeroVel, dt);
+		cached->hasContacts = false;
+
+		outTriangles.insert(outTriangles.end(), cached->triangles.begin(), cached->triangles.end());
+		return cached;
+	}
+
+	void Broadphase::saveContacts(CachedTriangles* cached, Mesh* mesh, Box* localBoundingBox, const std::vector<int>& triangles) {
+		// The contacts are a subsequence of the triangles, everything else in between wasn't reached
+		cached->clearance = INFINITY;
+		size_t contact = 0;
+		for (int triangle : triangles) {
+			if (contact < cached->contacts.size() && cached->contacts[contact] == triangle) {
+				contact++;
+				continue;
+			}
+
+			const Mesh::TriangleData& data = mesh->getTriangleData(triangle);
+			cached->clearance = glm::min(cached->clearance, Intersection::separation(localBoundingBox, data.vertices, data.edges, data.normal));
+		}
+
+		const Vec3Span vertices = localBoundingBox->getVertices();
+		for (int i = 0; i < 8; i++) {
+			cached->vertices[i] = vertices[i];
+		}
+		cached->hasContacts = true;
+	}
+
+	void Broadphase::collideWithEntity(Entity* entity, Box* entityBoundingBox, const glm::vec3& entityVel, Entity* e, std::vector<CollisionInfo>& collisionInfo, float& collisionTime, std::vector<CollisionInfo>& zeroDistances, const float& dt, const bool doSimpleCollisions) {
+		glm::vec3 otherEntityVel;
+
+		//Don't let an entity collide with itself
+		if (entity->getId() == e->getId()) {
+			return;
+		}
+
+		Box* otherBoundingBox = e->getComponent<BoundingBoxComponent>()->getBoundingBox();
+		MovementComponent* otherMovComp = e->getComponent<MovementComponent>();
+
+		if (otherMovComp) {
+			otherEntityVel = otherMovComp->velocity;
+		}
+		else {
+			otherEntityVel = { 0.f, 0.f, 0.f };
+		}
+
+		float tempCollisionTime = Intersection::continousSAT(entityBoundingBox, otherBoundingBox, entityVel, otherEntityVel, dt);
+		// Return if bounding box doesn't collide with entity bounding box
+		if (tempCollisionTime < 0.f || tempCollisionTime > collisionTime) {
+			return;
+		}
+
+		// Get collision
+		const MeshComponent* mesh = e->getComponent<MeshComponent>();
+		TransformComponent* transform = e->getComponent<TransformComponent>();
+		const CollidableComponent* collidable = e->getComponent<CollidableComponent>();
+
+		if (mesh && !(doSimpleCollisions && collidable->allowSimpleCollision)) {
+			// Entity has a model. Check collision with meshes
+			glm::mat4 transformMatrix(1.0f);
+			glm::mat4 inverseTransformMatrix(1.0f);
+			if (transform) {
+				// The matrices are already up to date when querying concurrently, updating them here would be a write other threads can see
+				transformMatrix = m_concurrentQueries ? transform->getMatrixWithoutUpdate() : transform->getMatrixWithUpdate();
+				inverseTransformMatrix = m_concurrentQueries ? transform->getInverseMatrixWithoutUpdate() : transform->getInverseMatrixWithUpdate();
+			}
+
+			entityBoundingBox->setMatrix(inverseTransformMatrix);
+
+			//Convert velocities to local space for mesh
+			glm::mat3 inverseRotationScale(inverseTransformMatrix);
+			glm::vec3 newEntityVel = inverseRotationScale * entityVel;
+			otherEntityVel = inverseRotationScale * otherEntityVel;
+
+			// Get triangles to test continous collision against from narrow phase octree in mesh
+			std::vector<int>& triangles = t_queryBuffers.triangles;
+			triangles.clear();
+			CachedTriangles* fullTest = getTrianglesToTest(entity, e, mesh->mesh, transformMatrix, entityBoundingBox, newEntityVel, otherEntityVel, dt, triangles);
+			if (fullTest) {
+				fullTest->contacts.clear();
+			}
+
+			//for (unsigned int j = 0; j < model->getModel()->getNumberOfMeshes(); j++) {
+			int numTriangles = triangles.size();
+
+			// Triangles are tested a packet at a time, the results are then handled in the same order as testing them one by one
+			Intersection::TrianglePacket packet;
+			int packetTriangles[Intersection::TrianglePacket::size];
+			float times[Intersection::TrianglePacket::size];
+
+			for (int j = 0; j < numTriangles; j++) {
+				const Mesh::TriangleData& data = mesh->mesh->getTriangleData(triangles[j]);
+				packetTriangles[packet.count] = triangles[j];
+				packet.add(data.vertices, data.edges, data.normal);
+
+				if (packet.count < Intersection::TrianglePacket::size && j < numTriangles - 1) {
+					continue;
+				}
+
+				Intersection::continousSAT(entityBoundingBox, packet, newEntityVel, otherEntityVel, dt, times);
+
+				for (int k = 0; k < packet.count; k++) {
+					float time = times[k];
+
+					if (fullTest && time >= 0.f) {
+						fullTest->contacts.push_back(packetTriangles[k]);
+					}
+
+					CollisionInfo* info = nullptr;
+					if (time > 0.f && time < collisionTime) {
+						collisionInfo.clear();
+						collisionTime = time;
+						collisionInfo.emplace_back();
+						info = &collisionInfo.back();
+					}
+					else if (time == collisionTime) {
+						collisionInfo.emplace_back();
+						info = &collisionInfo.back();
+					}
+					else if (time == 0.f) {
+						zeroDistances.emplace_back();
+						info = &zeroDistances.back();
+					}
+
+					if (info) {
+						info->setTriangle(e, packetTriangles[k], glm::vec3(transformMatrix * glm::vec4(packet.getVertex(k, 0), 1.0f)), glm::vec3(transformMatrix * glm::vec4(packet.getVertex(k, 1), 1.0f)), glm::vec3(transformMatrix * glm::vec4(packet.getVertex(k, 2), 1.0f)));
+					}
+				}
+
+				packet.count = 0;
+			}
+			//}
+
+			if (fullTest) {
+				saveContacts(fullTest, mesh->mesh, entityBoundingBox, triangles);
+			}
+
+			entityBoundingBox->setMatrix(glm::mat4(1.0f)); //Reset bounding box matrix to identity
+		}
+		else { // No model or simple collision opportunity
+			if (tempCollisionTime > 0.f && tempCollisionTime < collisionTime) {
+				// Collide with bounding box
+				collisionTime = tempCollisionTime;
+				collisionInfo.clear();
+				collisionInfo.emplace_back();
+				collisionInfo.back().setBox(e, otherBoundingBox);
+			}
+			else if (tempCollisionTime == collisionTime) {
+				collisionInfo.emplace_back();
+				collisionInfo.back().setBox(e, otherBoundingBox);
+			}
+			else if (tempCollisionTime == 0.f) {
+				zeroDistances.emplace_back();
+				zeroDistances.back().setBox(e, otherBoundingBox);
+			}
+		}
+	}
+
+	void Broadphase::intersectRayWithEntity(Ray* ray, Entity* e, RayIntersectionInfo* outIntersectionData, Entity* ignoreThis, const bool doSimpleIntersections) {
+		glm::vec3& rayDir = ray->getNormals()[0];
+
+		if (ignoreThis && e->getId() == ignoreThis->getId()) {
+			return;
+		}
+
+		Box* collidableBoundingBox = e->getComponent<BoundingBoxComponent>()->getBoundingBox();
+		glm::vec3 intersectionAxis;
+		float entityIntersectionDistance = Intersection::continousSAT(ray, collidableBoundingBox, rayDir, glm::vec3(0.f), INFINITY);
+
+		// Return if ray doesn't intersect the entity bounding box closer than the closest hit
+		if (entityIntersectionDistance < 0.0f && (entityIntersectionDistance < outIntersectionData->closestHit || outIntersectionData->closestHit < 0.0f)) {
+			return;
+		}
+
+		//Get Intersection
+		const MeshComponent* mesh = e->getComponent<MeshComponent>();
+		TransformComponent* transform = e->getComponent<TransformComponent>();
+		const CollidableComponent* collidable = e->getComponent<CollidableComponent>();
+
+		if (mesh && !(doSimpleIntersections && collidable->allowSimpleCollision)) {
+			// Entity has a model. Check collision with meshes
+			glm::mat4 inverseTransformMatrix(1.0f);
+			if (transform) {
+				inverseTransformMatrix = transform->getInverseMatrixWithUpdate();
+			}
+
+			ray->setMatrix(inverseTransformMatrix);
+
+			//Convert velocities to local space for mesh
+			glm::vec3 newRayDir = glm::mat3(inverseTransformMatrix) * rayDir;
+			glm::vec3 otherEntityVel(0.f);
+
+			// Get triangles to test continous collision against from narrow phase octree in mesh
+			std::vector<int>& triangles = t_queryBuffers.triangles;
+			triangles.clear();
+			mesh->mesh->getTrianglesForContinousCollisionTesting(triangles, ray, newRayDir, otherEntityVel, INFINITY);
+
+			// Triangle to set mesh data to avoid creating new shapes for each triangle in mesh
+			Triangle triangle(glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.0f));
+
+			//for (unsigned int j = 0; j < model->getModel()->getNumberOfMeshes(); j++) {
+			int numTriangles = triangles.size();
+
+			for (int j = 0; j < numTriangles; j++) {
+				const Mesh::TriangleData& data = mesh->mesh->getTriangleData(triangles[j]);
+				triangle.setData(data.vertices, data.edges, data.normal);
+
+				float distance = Intersection::continousSAT(ray, &triangle, newRayDir, otherEntityVel, INFINITY);
+
+				if (distance > 0.f && (distance < outIntersectionData->closestHit || outIntersectionData->closestHit < 0.f)) {
+					outIntersectionData->closestHit = distance;
+					outIntersectionData->entity = e;
+				}
+			}
+			//}
+
+			ray->setMatrix(glm::mat4(1.0f)); //Reset bounding box matrix to identity
+		}
+		else { // No model or simple collision opportunity
+			if (entityIntersectionDistance > 0.f && entityIntersectionDistance < outIntersectionData->closestHit) {
+				outIntersectionData->closestHit = entityIntersectionDistance;
+				outIntersectionData->entity = e;
+			}
+		}
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+#include "IdMap.h"
+#include "../Shapes/Shape.h"
+
+namespace Scuffed {
+
+	class Box;
+	class Entity;
+	class Mesh;
+	class Shape;
+	class Triangle;
+	class Ray;
+
+	namespace Broadphases {
+		enum types {
+			Octree,
+			AabbTree,
+			SweepAndPrune
+		};
+	}
+
+	// Common interface for the structures keeping track of which entities can collide.
+	// The narrow phase tests against a single entity are shared, the structures only decide which entities to test
+	class Broadphase {
+	public:
+		// A shape the entity collides with. Holds its world space data itself, so it can be copied around and thrown away without touching the heap
+		struct CollisionInfo {
+			glm::vec3 intersectionAxis = { 0.0f, 0.0f, 0.0f };
+			float intersectionDepth = 0.f;
+			//glm::vec3 intersectionPosition;
+			Entity* entity = nullptr;
+
+			ShapeTypes::types shapeType = ShapeTypes::Box; // Box or Triangle
+			int triangle = -1; // First index of the triangle in the entity's mesh, -1 for boxes
+			glm::vec3 vertices[8]; // 3 used by triangles
+			glm::vec3 normals[6]; // Box face normals, unused by triangles
+
+			void setTriangle(Entity* e, int meshTriangle, const glm::vec3& v1, const glm::vec3& v2, const glm::vec3& v3);
+			void setBox(Entity* e, Box* box);
+			// Sets up one of the given shapes as the collided shape and returns it
+			Shape* getShape(Triangle& triangleShape, Box& boxShape) const;
+		};
+
+		struct RayIntersectionInfo {
+			float closestHit = -1.0f;
+			Entity* entity;
+		};
+
+		// The triangles of a mesh entity close to a colliding entity, found by an earlier query.
+		// Collisions with the mesh can be tested against only these as long as the entity stays within the area and the mesh doesn't move.
+		// The triangles the last full test could reach are kept as contacts. Only they have to be tested again while the entity is closer to where it was than to any other triangle
+		struct CachedTriangles {
+			unsigned int entityId;
+			Mesh* mesh;
+			unsigned int meshVersion;
+			glm::mat4 transform;
+			glm::vec3 min, max; // Area in mesh space
+			std::vector<int> triangles;
+			bool used; // Used since the owner's last update
+
+			bool hasContacts;
+			std::vector<int> contacts; // In the same order as in triangles
+			glm::vec3 vertices[8]; // The entity's bounding box in mesh space at the last full test
+			float clearance; // The other triangles were at least this far from the bounding box
+		};
+
+		// Two entities that might collide. entity1 is one of the moving entities given to getPairs and entity2 is in the broadphase.
+		// If entity2 is moving as well and entity1 is in the broadphase, entity2 should also be tested against entity1
+		struct EntityPair {
+			Entity* entity1;
+			Entity* entity2;
+		};
+
+		Broadphase();
+		virtual ~Broadphase();
+
+		virtual void addEntity(Entity* newEntity) = 0;
+		virtual void addEntities(std::vector<Entity*>* newEntities);
+
+		virtual void removeEntity(Entity* entityToRemove) = 0;
+		virtual void removeEntities(std::vector<Entity*> entitiesToRemove);
+
+		virtual bool hasEntity(Entity* entity) const = 0;
+
+		// dt is the time the entities will move during before the next update
+		virtual void update(const float dt) = 0;
+
+		// Queries between begin and end only read the structure, entities and meshes, so they can run on several threads.
+		// Nothing in the structure (including the entities' bounding boxes, transforms and velocities) may be changed in between
+		virtual void beginConcurrentQueries() = 0;
+		virtual void endConcurrentQueries();
+
+		// Triangles are always collided with and intersected from both sides, checkBackfaces is kept for compatibility and not used
+		virtual void getNextContinousCollision(Entity* entity, std::vector<CollisionInfo>& outCollisionInfo, float& collisionTime, std::vector<CollisionInfo>& zeroDistances, const float& dt = INFINITY, const bool doSimpleCollisions = false, const bool checkBackfaces = false);
+		// Same as above but with the bounding box and velocity of the entity given instead of read from its components
+		virtual void getNextContinousCollision(Entity* entity, Box* entityBoundingBox, const glm::vec3& entityVel, std::vector<CollisionInfo>& outCollisionInfo, float& collisionTime, std::vector<CollisionInfo>& zeroDistances, const float& dt = INFINITY, const bool doSimpleCollisions = false, const bool checkBackfaces = false) = 0;
+		virtual void getRayIntersection(const glm::vec3& rayStart, const glm::vec3& rayDir, RayIntersectionInfo* outIntersectionData, Entity* ignoreThis = nullptr, const bool doSimpleIntersections = false, const bool checkBackfaces = false) = 0;
+
+		// The box an entity can reach during dt. Covers changes of direction, as long as the speed doesn't increase
+		static void getReach(Box* boundingBox, const glm::vec3& velocity, const float dt, glm::vec3& outMin, glm::vec3& outMax);
+		// Same as above for an entity that also turns around pivot with angularVelocity (axis times radians per second)
+		static void getReach(Box* boundingBox, const glm::vec3& velocity, const glm::vec3& pivot, const glm::vec3& angularVelocity, const float dt, glm::vec3& outMin, glm::vec3& outMax);
+		// Finds all pairs of entities whose reaches overlap, where at least one of them is in movingEntities. Each pair is only added once.
+		// reachMins and reachMaxes are indexed like movingEntities, the other entities are treated as standing still
+		virtual void getPairs(const std::vector<Entity*>& movingEntities, const std::vector<glm::vec3>& reachMins, const std::vector<glm::vec3>& reachMaxes, std::vector<EntityPair>& outPairs);
+		// Same as getNextContinousCollision but only tests against the given entities, usually the ones paired with the entity by getPairs
+		void getNextContinousCollisionWithEntities(Entity* entity, Box* entityBoundingBox, const glm::vec3& entityVel, const std::vector<Entity*>& entities, std::vector<CollisionInfo>& outCollisionInfo, float& collisionTime, std::vector<CollisionInfo>& zeroDistances, const float& dt = INFINITY, const bool doSimpleCollisions = false, const bool checkBackfaces = false);
+		// Same as getNextContinousCollision for an entity that also turns around pivot with angularVel (axis times radians per second).
+		// Every box and triangle within the reach is tested with conservative advancement, which is slower than the linear sweep so it is only meant for turning entities.
+		// If the advancement runs out of steps before reaching a shape, collisionTime is how far the entity can safely move and outCollisionInfo is left empty. The entity should be moved that far and tested again
+		void getNextRotatingCollision(Entity* entity, Box* entityBoundingBox, const glm::vec3& entityVel, const glm::vec3& pivot, const glm::vec3& angularVel, std::vector<CollisionInfo>& outCollisionInfo, float& collisionTime, std::vector<CollisionInfo>& zeroDistances, const float dt, const bool doSimpleCollisions = false);
+
+	protected:
+		bool m_concurrentQueries;
+		float m_contactCacheMargin;
+
+		// Returns if the entity's bounding box has changed since the last call and clears the change flag
+		static bool hasChanged(Entity* entity);
+		// Updates the lazily calculated data of the entity that the queries read
+		void warmCachedData(Entity* entity);
+		static void getAabb(Shape* shape, glm::vec3& outMin, glm::vec3& outMax);
+		static bool aabbsOverlap(const glm::vec3& min1, const glm::vec3& max1, const glm::vec3& min2, const glm::vec3& max2);
+
+		// Adds every entity that might overlap the box, each entity only once
+		virtual void getEntitiesInAabb(const glm::vec3& min, const glm::vec3& max, std::vector<Entity*>& outEntities) = 0;
+
+		// Entity id -> index in the movingEntities given to getPairs, -1 for other entities. Only valid during getPairs
+		IdMap m_movingEntityIndices;
+		void setMovingEntityIndices(const std::vector<Entity*>& movingEntities);
+		void clearMovingEntityIndices(const std::vector<Entity*>& movingEntities);
+		int getMovingEntityIndex(Entity* entity) const;
+		// Used by getPairs to find the pairs of moving entities, kept to reuse their memory
+		std::vector<int> m_reachOrder; // Indices in movingEntities sorted by the reach along x
+		std::vector<char> m_isInBroadphase; // Indexed like movingEntities
+		// Adds the pair if the reach of the moving entity overlaps the other entity's reach or bounding box
+		void testPair(const std::vector<Entity*>& movingEntities, const std::vector<glm::vec3>& reachMins, const std::vector<glm::vec3>& reachMaxes, int movingIndex, Entity* other, std::vector<EntityPair>& outPairs);
+
+		// Finds the triangles of the mesh that the moving box can hit, from the contact cache of the entity when possible.
+		// Returns the cache entry when all of its triangles were given, the test results should then be saved as its contacts
+		CachedTriangles* getTrianglesToTest(Entity* entity, Entity* meshEntity, Mesh* mesh, const glm::mat4& transformMatrix, Box* localBoundingBox, glm::vec3& localVel, glm::vec3& meshVel, const float& dt, std::vector<int>& outTriangles);
+		// Saves which of the tested triangles could be reached and how far the others are from the box
+		void saveContacts(CachedTriangles* cached, Mesh* mesh, Box* localBoundingBox, const std::vector<int>& triangles);
+
+		void collideWithEntity(Entity* entity, Box* entityBoundingBox, const glm::vec3& entityVel, Entity* e, std::vector<CollisionInfo>& collisionInfo, float& collisionTime, std::vector<CollisionInfo>& zeroDistances, const float& dt, const bool doSimpleCollisions);
+		void intersectRayWithEntity(Ray* ray, Entity* e, RayIntersectionInfo* outIntersectionData, Entity* ignoreThis, const bool doSimpleIntersections);
+	};
+
+}
\ No newline at end of file
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <vector>
+#include <new>
+
+#include "IdMap.h"
+
+namespace Scuffed {
+
+	class Component;
+
+	// Type erased base to let the ComponentRegistry own pools of different component types
+	class BaseComponentPool {
+	public:
+		BaseComponentPool() {};
+		virtual ~BaseComponentPool() {};
+
+		virtual Component* getComponent(unsigned int entityId) = 0;
+		virtual bool has(unsigned int entityId) const = 0;
+		virtual void remove(unsigned int entityId) = 0;
+		virtual size_t size() const = 0;
+	};
+
+	// Sparse set storage for one component type.
+	// Components are placed in fixed size chunks that are never moved or freed while the pool is alive, so pointers handed out to the client (bindMatrixPointer etc) stay valid.
+	// m_sparse maps entity id -> slot, the dense arrays keep all used slots packed for linear iteration.
+	template<typename ComponentType>
+	class ComponentPool final : public BaseComponentPool {
+	public:
+		ComponentPool();
+		~ComponentPool();
+
+		template<typename... Targs>
+		ComponentType* add(unsigned int entityId, Targs... args);
+		ComponentType* get(unsigned int entityId);
+		Component* getComponent(unsigned int entityId) override;
+		bool has(unsigned int entityId) const override;
+		void remove(unsigned int entityId) override;
+		size_t size() const override;
+
+		// Dense iteration, index has to be in [0, size())
+		ComponentType* at(size_t index);
+		unsigned int entityAt(size_t index) const;
+
+	private:
+		static const int CHUNK_SIZE = 256;
+
+		struct Chunk {
+			alignas(ComponentType) unsigned char data[sizeof(ComponentType) * CHUNK_SIZE];
+		};
+
+		ComponentType* slotPointer(int slot);
+
+	private:
+		std::vector<Chunk*> m_chunks;
+		std::vector<int> m_freeSlots;
+		int m_nrOfSlots;
+
+		IdMap m_sparse; // Entity id -> slot. -1 if the entity does not have this component
+
+		std::vector<int> m_denseSlots;
+		std::vector<unsigned int> m_denseEntities;
+		std::vector<int> m_slotToDense;
+	};
+
+	template<typename ComponentType>
+	inline ComponentPool<ComponentType>::ComponentPool() {
+		m_nrOfSlots = 0;
+	}
+
+	template<typename ComponentType>
+	inline ComponentPool<ComponentType>::~ComponentPool() {
+		for (size_t i = 0; i < m_denseSlots.size(); i++) {
+			slotPointer(m_denseSlots[i])->~ComponentType();
+		}
+		for (auto chunk : m_chunks) {
+			delete chunk;
+		}
+	}
+
+	template<typename ComponentType>
+	template<typename... Targs>
+	inline ComponentType* ComponentPool<ComponentType>::add(unsigned int entityId, Targs... args) {
+		if (has(entityId)) {
+			return get(entityId);
+		}
+
+		int slot;
+		if (m_freeSlots.size() > 0) {
+			slot = m_freeSlots.back();
+			m_freeSlots.pop_back();
+		}
+		else {
+			slot = m_nrOfSlots++;
+			if ((size_t)slot >= m_chunks.size() * CHUNK_SIZE) {
+				m_chunks.push_back(SN_NEW Chunk());
+			}
+			m_slotToDense.resize(m_nrOfSlots, -1);
+		}
+
+		ComponentType* component = new (slotPointer(slot)) ComponentType(args...);
+
+		m_sparse.set(entityId, slot);
+
+		m_slotToDense[slot] = (int)m_denseSlots.size();
+		m_denseSlots.push_back(slot);
+		m_denseEntities.push_back(entityId);
+
+		return component;
+	}
+
+	template<typename ComponentType>
+	inline ComponentType* ComponentPool<ComponentType>::get(unsigned int entityId) {
+		const int slot = m_sparse.get(entityId);
+		if (slot >= 0) {
+			return slotPointer(slot);
+		}
+		return nullptr;
+	}
+
+	template<typename ComponentType>
+	inline Component* ComponentPool<ComponentType>::getComponent(unsigned int entityId) {
+		return get(entityId);
+	}
+
+	template<typename ComponentType>
+	inline bool ComponentPool<ComponentType>::has(unsigned int entityId) const {
+		return m_sparse.get(entityId) >= 0;
+	}
+
+	template<typename ComponentType>
+	inline void ComponentPool<ComponentType>::remove(unsigned int entityId) {
+		if (!has(entityId)) {
+			return;
+		}
+
+		int slot = m_sparse.get(entityId);
+		slotPointer(slot)->~ComponentType();
+		m_sparse.remove(entityId);
+		m_freeSlots.push_back(slot);
+
+		// Swap and pop to keep the dense arrays packed
+		int denseIndex = m_slotToDense[slot];
+		int lastIndex = (int)m_denseSlots.size() - 1;
+		if (denseIndex != lastIndex) {
+			m_denseSlots[denseIndex] = m_denseSlots[lastIndex];
+			m_denseEntities[denseIndex] = m_denseEntities[lastIndex];
+			m_slotToDense[m_denseSlots[denseIndex]] = denseIndex;
+		}
+		m_denseSlots.pop_back();
+		m_denseEntities.pop_back();
+		m_slotToDense[slot] = -1;
+	}
+
+	template<typename ComponentType>
+	inline size_t ComponentPool<ComponentType>::size() const {
+		return m_denseSlots.size();
+	}
+
+	template<typename ComponentType>
+	inline ComponentType* ComponentPool<ComponentType>::at(size_t index) {
+		return slotPointer(m_denseSlots[index]);
+	}
+
+	template<typename ComponentType>
+	inline unsigned int ComponentPool<ComponentType>::entityAt(size_t index) const {
+		return m_denseEntities[index];
+	}
+
+	template<typename ComponentType>
+	inline ComponentType* ComponentPool<ComponentType>::slotPointer(int slot) {
+		return reinterpret_cast<ComponentType*>(m_chunks[slot / CHUNK_SIZE]->data) + (slot % CHUNK_SIZE);
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#include "../pch.h"
+
+#include "ComponentRegistry.h"
+#include "../Components/Components.h"
+
+namespace Scuffed {
+
+	ComponentRegistry::ComponentRegistry() {
+		m_pools[Components::BoundingBoxComponent] = SN_NEW ComponentPool<BoundingBoxComponent>();
+		m_pools[Components::CollidableComponent] = SN_NEW ComponentPool<CollidableComponent>();
+		m_pools[Components::CollisionComponent] = SN_NEW ComponentPool<CollisionComponent>();
+		m_pools[Components::MovementComponent] = SN_NEW ComponentPool<MovementComponent>();
+		m_pools[Components::MeshComponent] = SN_NEW ComponentPool<MeshComponent>();
+		m_pools[Components::SpeedLimitComponent] = SN_NEW ComponentPool<SpeedLimitComponent>();
+		m_pools[Components::TransformComponent] = SN_NEW ComponentPool<TransformComponent>();
+	}
+
+	ComponentRegistry::~ComponentRegistry() {
+		for (int i = 0; i < Components::NUMBER_OF_TYPES; i++) {
+			delete m_pools[i];
+		}
+	}
+
+	BaseComponentPool* ComponentRegistry::getPool(int componentNumber) {
+		if (componentNumber >= 0 && componentNumber < Components::NUMBER_OF_TYPES) {
+			return m_pools[componentNumber];
+		}
+		return nullptr;
+	}
+
+	void ComponentRegistry::removeAllComponents(unsigned int entityId) {
+		for (int i = 0; i < Components::NUMBER_OF_TYPES; i++) {
+			m_pools[i]->remove(entityId);
+		}
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "ComponentPool.h"
+#include "../Components/Component.h"
+
+namespace Scuffed {
+
+	// Owns one ComponentPool per component type. Entity is a facade on top of this.
+	class ComponentRegistry {
+	public:
+		ComponentRegistry();
+		virtual ~ComponentRegistry();
+
+		template<typename ComponentType>
+		ComponentPool<ComponentType>* getPool();
+
+		virtual BaseComponentPool* getPool(int componentNumber);
+		virtual void removeAllComponents(unsigned int entityId);
+
+	private:
+		BaseComponentPool* m_pools[Components::NUMBER_OF_TYPES];
+	};
+
+	template<typename ComponentType>
+	inline ComponentPool<ComponentType>* ComponentRegistry::getPool() {
+		return static_cast<ComponentPool<ComponentType>*>(m_pools[ComponentType::TYPE]);
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+#include "../pch.h"
+
+#include <algorithm>
+
+#include "IdMap.h"
+
+namespace Scuffed {
+
+	IdMap::IdMap() {
+		m_firstPage = 0;
+	}
+
+	IdMap::~IdMap() {
+		for (auto page : m_pages) {
+			delete page;
+		}
+	}
+
+	void IdMap::set(unsigned int id, int index) {
+		unsigned int page = id >> PAGE_BITS;
+		if (m_pages.empty()) {
+			m_firstPage = page;
+		}
+		else if (page < m_firstPage) {
+			m_pages.insert(m_pages.begin(), m_firstPage - page, nullptr);
+			m_firstPage = page;
+		}
+
+		page -= m_firstPage;
+		if (page >= m_pages.size()) {
+			m_pages.resize((size_t)page + 1, nullptr);
+		}
+
+		if (!m_pages[page]) {
+			m_pages[page] = SN_NEW Page();
+			std::fill(m_pages[page]->indices, m_pages[page]->indices + PAGE_SIZE, -1);
+			m_pages[page]->nrOfIds = 0;
+		}
+
+		int& slot = m_pages[page]->indices[id & (PAGE_SIZE - 1)];
+		if (slot < 0) {
+			m_pages[page]->nrOfIds++;
+		}
+		slot = index;
+	}
+
+	void IdMap::remove(unsigned int id) {
+		const unsigned int page = (id >> PAGE_BITS) - m_firstPage;
+		if (page >= m_pages.size() || !m_pages[page]) {
+			return;
+		}
+
+		int& slot = m_pages[page]->indices[id & (PAGE_SIZE - 1)];
+		if (slot < 0) {
+			return;
+		}
+		slot = -1;
+
+		if (--m_pages[page]->nrOfIds > 0) {
+			return;
+		}
+
+		delete m_pages[page];
+		m_pages[page] = nullptr;
+
+		// Drop the empty pages at the ends
+		while (!m_pages.empty() && !m_pages.back()) {
+			m_pages.pop_back();
+		}
+		size_t nrOfEmpty = 0;
+		while (nrOfEmpty < m_pages.size() && !m_pages[nrOfEmpty]) {
+			nrOfEmpty++;
+		}
+		if (nrOfEmpty > 0) {
+			m_pages.erase(m_pages.begin(), m_pages.begin() + nrOfEmpty);
+			m_firstPage += (unsigned int)nrOfEmpty;
+		}
+	}
+
+}
\ No newline at end of file
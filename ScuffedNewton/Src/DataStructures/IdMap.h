@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+
+namespace Scuffed {
+
+	// Maps entity ids to indices, -1 for the ids that aren't in the map.
+	// Entity ids are never reused, so the ids in use keep moving up as entities are added and removed. The map is split into pages that are freed
+	// when their last id is removed, and the empty pages at the ends are dropped, so it only takes memory for the range of ids still in use
+	class IdMap final {
+	public:
+		IdMap();
+		~IdMap();
+		IdMap(const IdMap&) = delete;
+		IdMap& operator=(const IdMap&) = delete;
+
+		int get(unsigned int id) const;
+		// index has to be 0 or more
+		void set(unsigned int id, int index);
+		void remove(unsigned int id);
+
+	private:
+		static const unsigned int PAGE_BITS = 10;
+		static const unsigned int PAGE_SIZE = 1 << PAGE_BITS;
+
+		struct Page {
+			int indices[PAGE_SIZE];
+			unsigned int nrOfIds;
+		};
+
+		// m_pages[i] holds the ids from (m_firstPage + i) * PAGE_SIZE, nullptr if none of them are in the map
+		std::vector<Page*> m_pages;
+		unsigned int m_firstPage;
+	};
+
+	inline int IdMap::get(unsigned int id) const {
+		const unsigned int page = (id >> PAGE_BITS) - m_firstPage; // Wraps around to a large number for ids before the first page
+		if (page >= m_pages.size() || !m_pages[page]) {
+			return -1;
+		}
+		return m_pages[page]->indices[id & (PAGE_SIZE - 1)];
+	}
+
+}
\ No newline at end of file
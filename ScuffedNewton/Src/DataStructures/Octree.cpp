@@ -3,11 +3,8 @@
 #include "Octree.h"
 #include "../Calculations/Intersection.h"
 #include "../DataTypes/Entity.h"
-#include "../DataTypes/Mesh.h"
 #include "../Components/Components.h"
 #include "../Shapes/Box.h"
-#include "../Shapes/Triangle.h"
-#include "../Shapes/Shape.h"
 #include "../Shapes/Ray.h"
 
 #include "../Utils/Utils.h"
@@ -20,15 +17,13 @@ namespace Scuffed {
 		m_softLimitMeshes = 4;
 		m_minimumNodeHalfSize = 4.0f;
 
-		m_baseNode.halfSize = glm::vec3(20.0f, 20.0f, 20.0f);
-		m_baseNode.nodeBB = SN_NEW Box(m_baseNode.halfSize, glm::vec3(0.0f));
-
-		m_baseNode.parentNode = nullptr;
-		m_baseNode.nrOfEntities = 0;
+		m_nodes.emplace_back();
+		m_nodes[0].halfSize = glm::vec3(20.0f, 20.0f, 20.0f);
+		m_nodes[0].center = glm::vec3(0.0f);
 	}
 
 	Octree::~Octree() {
-		clean(&m_baseNode);
+
 	}
 
 	void Octree::expandBaseNode(glm::vec3 direction) {
@@ -38,45 +33,58 @@ namespace Scuffed {
 		y = direction.y >= 0.0f;
 		z = direction.z >= 0.0f;
 
-		Node newBaseNode;
-		Box* baseNodeBB = m_baseNode.nodeBB;
-		newBaseNode.nodeBB = SN_NEW Box(m_baseNode.halfSize * 2.0f, baseNodeBB->getMiddle() - m_baseNode.halfSize + glm::vec3(x * m_baseNode.halfSize.x * 2.0f, y * m_baseNode.halfSize.y * 2.0f, z * m_baseNode.halfSize.z * 2.0f));
-		newBaseNode.halfSize = m_baseNode.halfSize * 2.0f;
+		int firstChild = allocateChildBlock();
 
-		newBaseNode.nrOfEntities = 0;
-		newBaseNode.parentNode = nullptr;
+		Node oldBaseNode = m_nodes[0];
+		glm::vec3 halfSize = oldBaseNode.halfSize;
+		glm::vec3 newCenter = oldBaseNode.center - halfSize + glm::vec3(x * halfSize.x * 2.0f, y * halfSize.y * 2.0f, z * halfSize.z * 2.0f);
 
 		for (int i = 0; i < 2; i++) {
 			for (int j = 0; j < 2; j++) {
 				for (int k = 0; k < 2; k++) {
-					Node tempChildNode;
+					int childIndex = firstChild + i * 4 + j * 2 + k;
+					Node& child = m_nodes[childIndex];
 					if (i != x && j != y && k != z) {
-						tempChildNode = m_baseNode;
+						// The old base node becomes this child. Point its children and entities to the new index
+						child = oldBaseNode;
+						if (child.firstChild >= 0) {
+							for (int l = 0; l < 8; l++) {
+								m_nodes[child.firstChild + l].parentNode = childIndex;
+							}
+						}
+						for (int record = child.firstEntity; record >= 0; record = m_entityRecords[record].next) {
+							m_entityRecords[record].node = childIndex;
+						}
 					}
 					else {
-						tempChildNode.nodeBB = SN_NEW Box(m_baseNode.halfSize, newBaseNode.nodeBB->getMiddle() - m_baseNode.halfSize + glm::vec3(m_baseNode.halfSize.x * 2.0f * i, m_baseNode.halfSize.y * 2.0f * j, m_baseNode.halfSize.z * 2.0f * k));
-						tempChildNode.halfSize = m_baseNode.halfSize;
-						tempChildNode.nrOfEntities = 0;
+						child = Node();
+						child.center = newCenter - halfSize + glm::vec3(halfSize.x * 2.0f * i, halfSize.y * 2.0f * j, halfSize.z * 2.0f * k);
+						child.halfSize = halfSize;
 					}
-					tempChildNode.parentNode = &newBaseNode;
-					newBaseNode.childNodes.push_back(tempChildNode);
+					child.parentNode = 0;
 				}
 			}
 		}
 
-		m_baseNode = newBaseNode;
+		Node& baseNode = m_nodes[0];
+		baseNode = Node();
+		baseNode.center = newCenter;
+		baseNode.halfSize = halfSize * 2.0f;
+		baseNode.firstChild = firstChild;
+		baseNode.nrOfEntitiesInSubtree = oldBaseNode.nrOfEntitiesInSubtree;
 	}
 
 
-	glm::vec3 Octree::findCornerOutside(Entity* entity, Node* testNode) {
+	glm::vec3 Octree::findCornerOutside(Entity* entity, int testNode) {
 		//Find if any corner of a entity's bounding box is outside of node. Returns a vector towards the outside corner if one is found. Otherwise a 0.0f vec is returned.
 		glm::vec3 directionVec(0.0f, 0.0f, 0.0f);
 
-		const std::vector<glm::vec3>& corners = entity->getComponent<BoundingBoxComponent>()->getBoundingBox()->getVertices();
-		glm::vec3 testNodeHalfSize = testNode->halfSize;
+		const Vec3Span corners = entity->getComponent<BoundingBoxComponent>()->getBoundingBox()->getVertices();
+		glm::vec3 testNodeHalfSize = m_nodes[testNode].halfSize;
+		glm::vec3 testNodeCenter = m_nodes[testNode].center;
 
 		for (int i = 0; i < 8; i++) {
-			glm::vec3 distanceVec = corners[i] - testNode->nodeBB->getMiddle();
+			glm::vec3 distanceVec = corners[i] - testNodeCenter;
 
 			if (distanceVec.x < -testNodeHalfSize.x || distanceVec.x > testNodeHalfSize.x ||
 				distanceVec.y < -testNodeHalfSize.y || distanceVec.y > testNodeHalfSize.y ||
@@ -89,69 +97,76 @@ namespace Scuffed {
 		return directionVec;
 	}
 
-	bool Octree::addEntityRec(Entity* newEntity, Node* currentNode) {
+	bool Octree::isInsideNode(Entity* entity, int testNode) {
+		return glm::length(findCornerOutside(entity, testNode)) < 1.0f;
+	}
+
+	bool Octree::addEntityRec(int record, int currentNode) {
 		// TODO: Take movement into consideration
 
 		bool entityAdded = false;
+		Entity* newEntity = m_entityRecords[record].entity;
 
-		glm::vec3 isInsideVec = findCornerOutside(newEntity, currentNode);
-		if (glm::length(isInsideVec) < 1.0f) {
+		if (isInsideNode(newEntity, currentNode)) {
 			//The current node does contain the whole mesh. Keep going deeper or add to this node if no smaller nodes are allowed
 
-			if (currentNode->childNodes.size() > 0) { //Not leaf node
+			int firstChild = m_nodes[currentNode].firstChild;
+			if (firstChild >= 0) { //Not leaf node
 				//Recursively call children
-
-				for (unsigned int i = 0; i < currentNode->childNodes.size(); i++) {
-					entityAdded = addEntityRec(newEntity, &currentNode->childNodes[i]);
-
-					if (entityAdded) {
-						//Mesh was added to child node. Break loop. No need to try the rest of the children
-						i = (unsigned int)currentNode->childNodes.size();
-					}
+				for (int i = 0; i < 8 && !entityAdded; i++) {
+					entityAdded = addEntityRec(record, firstChild + i);
 				}
 
 				if (!entityAdded) { //Mesh did not fit in any child node
 					//Add mesh to this node
-					currentNode->entities.push_back(newEntity);
-					currentNode->nrOfEntities++;
+					linkEntityRecord(record, currentNode);
 					entityAdded = true;
 				}
 			}
 			else { //Is leaf node
-				if (currentNode->nrOfEntities < m_softLimitMeshes || currentNode->halfSize.x / 2.0f < m_minimumNodeHalfSize) { //Soft limit not reached or smaller nodes are not allowed
+				if (m_nodes[currentNode].nrOfEntities < m_softLimitMeshes || m_nodes[currentNode].halfSize.x / 2.0f < m_minimumNodeHalfSize) { //Soft limit not reached or smaller nodes are not allowed
 					//Add mesh to this node
-					currentNode->entities.push_back(newEntity);
-					currentNode->nrOfEntities++;
+					linkEntityRecord(record, currentNode);
 					entityAdded = true;
 				}
 				else {
-					//Create more children
+					//Create more children. Can reallocate m_nodes so no references to nodes are held across this
+					firstChild = allocateChildBlock();
+					glm::vec3 center = m_nodes[currentNode].center;
+					glm::vec3 halfSize = m_nodes[currentNode].halfSize;
+
 					for (int i = 0; i < 2; i++) {
 						for (int j = 0; j < 2; j++) {
 							for (int k = 0; k < 2; k++) {
-								Box* currentNodeBB = currentNode->nodeBB;
-								Node tempChildNode;
-								tempChildNode.nodeBB = SN_NEW Box(currentNode->halfSize / 2.0f, currentNodeBB->getMiddle() - currentNode->halfSize / 2.0f + glm::vec3(currentNode->halfSize.x * i, currentNode->halfSize.y * j, currentNode->halfSize.z * k));
-								tempChildNode.halfSize = currentNode->halfSize / 2.0f;
-								tempChildNode.nrOfEntities = 0;
-								tempChildNode.parentNode = currentNode;
-								currentNode->childNodes.push_back(tempChildNode);
-
-								//Try to put meshes that was in this leaf node in the new child nodes.
-								for (int l = 0; l < currentNode->nrOfEntities; l++) {
-									if (addEntityRec(currentNode->entities[l], &currentNode->childNodes.back())) {
-										//Mesh was successfully added to child. Remove it from this node.
-										currentNode->entities.erase(currentNode->entities.begin() + l);
-										currentNode->nrOfEntities--;
-										l--;
-									}
-								}
+								Node& child = m_nodes[firstChild + i * 4 + j * 2 + k];
+								child = Node();
+								child.center = center - halfSize / 2.0f + glm::vec3(halfSize.x * i, halfSize.y * j, halfSize.z * k);
+								child.halfSize = halfSize / 2.0f;
+								child.parentNode = currentNode;
 							}
 						}
 					}
+					m_nodes[currentNode].firstChild = firstChild;
+
+					//Try to put meshes that was in this leaf node in the new child nodes.
+					int movedRecord = m_nodes[currentNode].firstEntity;
+					while (movedRecord >= 0) {
+						int nextRecord = m_entityRecords[movedRecord].next;
+						unlinkEntityRecord(movedRecord);
+
+						bool movedToChild = false;
+						for (int i = 0; i < 8 && !movedToChild; i++) {
+							movedToChild = addEntityRec(movedRecord, firstChild + i);
+						}
+						if (!movedToChild) {
+							linkEntityRecord(movedRecord, currentNode);
+						}
+
+						movedRecord = nextRecord;
+					}
 
 					//Try to add the mesh to newly created child nodes. It gets placed in current node within recursion if the children can not contain it.
-					entityAdded = addEntityRec(newEntity, currentNode);
+					entityAdded = addEntityRec(record, currentNode);
 				}
 			}
 		}
@@ -159,317 +174,233 @@ namespace Scuffed {
 		return entityAdded;
 	}
 
-	bool Octree::removeEntityRec(Entity* entityToRemove, Node* currentNode) {
-		bool entityRemoved = false;
-
-		//Look for mesh in this node
-		for (int i = 0; i < currentNode->nrOfEntities; i++) {
-			if (currentNode->entities[i]->getId() == entityToRemove->getId()) {
-				//Mesh found - Remove it
-				currentNode->entities[i] = currentNode->entities.back();
-				currentNode->entities.pop_back();
-				//currentNode->entities.erase(currentNode->entities.begin() + i);
-				currentNode->nrOfEntities--;
-				entityRemoved = true;
-				i = currentNode->nrOfEntities;
-			}
-		}
+	void Octree::addEntityFromBaseNode(int record) {
+		Entity* entity = m_entityRecords[record].entity;
 
-		if (!entityRemoved) {
-			//Mesh was not in this node. Recursively call this function for the children
-			for (unsigned int i = 0; i < currentNode->childNodes.size(); i++) {
-				if (removeEntityRec(entityToRemove, &currentNode->childNodes[i])) {
-					//Mesh was removed by one of the children, break the loop
-					entityRemoved = true;
-					i = (unsigned int)currentNode->childNodes.size();
-				}
-			}
+		// See if the base node needs to be bigger
+		glm::vec3 directionVec = findCornerOutside(entity, 0);
+		while (glm::length(directionVec) != 0.0f) {
+			// Entity is outside base node
+			// Create bigger base node
+			expandBaseNode(directionVec);
+			directionVec = findCornerOutside(entity, 0);
 		}
 
-		return entityRemoved;
+		addEntityRec(record, 0);
 	}
 
-	void Octree::updateRec(Node* currentNode, std::vector<Entity*>* entitiesToReAdd) {
-		for (int i = 0; i < currentNode->nrOfEntities; i++) {
-			if (currentNode->entities[i]->getComponent<BoundingBoxComponent>()->getBoundingBox()->getChange()) { //Entity has changed
-				//Re-add the entity to get it in the right node
-				Entity* tempEntity = currentNode->entities[i];
-				//First remove the entity from this node to avoid duplicates
-				bool removed = removeEntityRec(currentNode->entities[i], currentNode);
-
-				if (removed) {
-					i--;
-					//Then store the entity to re-add it to the tree in the right node
-					entitiesToReAdd->push_back(tempEntity);
+	void Octree::updateEntity(int record) {
+		Entity* entity = m_entityRecords[record].entity;
+		int node = m_entityRecords[record].node;
+
+		if (isInsideNode(entity, node)) {
+			// Still inside its node. Only move it if it now fits in one of the children
+			int firstChild = m_nodes[node].firstChild;
+			if (firstChild < 0) {
+				return;
+			}
+
+			for (int i = 0; i < 8; i++) {
+				if (isInsideNode(entity, firstChild + i)) {
+					unlinkEntityRecord(record);
+					if (!addEntityRec(record, firstChild + i)) {
+						linkEntityRecord(record, node);
+					}
+					return;
 				}
 			}
+			return;
+		}
+
+		// Left its node. Move up to the closest node that contains it and go down from there
+		unlinkEntityRecord(record);
+		node = m_nodes[node].parentNode;
+		while (node >= 0 && !isInsideNode(entity, node)) {
+			node = m_nodes[node].parentNode;
 		}
 
-		for (unsigned int i = 0; i < currentNode->childNodes.size(); i++) {
-			updateRec(&currentNode->childNodes[i], entitiesToReAdd);
+		if (node < 0) {
+			addEntityFromBaseNode(record);
+		}
+		else {
+			addEntityRec(record, node);
 		}
 	}
 
-	void Octree::getNextContinousCollisionRec(Entity* entity, Node* currentNode, std::vector<CollisionInfo>& collisionInfo, float& collisionTime, std::vector<CollisionInfo>& zeroDistances, const float& dt, const bool doSimpleCollisions, const bool checkBackfaces) {
-		Box* nodeBoundingBox = currentNode->nodeBB;
-		Box* entityBoundingBox = entity->getComponent<BoundingBoxComponent>()->getBoundingBox();
-		MovementComponent* movComp = entity->getComponent<MovementComponent>();
+	int Octree::allocateChildBlock() {
+		if (!m_freeChildBlocks.empty()) {
+			int firstChild = m_freeChildBlocks.back();
+			m_freeChildBlocks.pop_back();
+			return firstChild;
+		}
 
-		glm::vec3 entityVel(0.f);
+		int firstChild = (int)m_nodes.size();
+		m_nodes.resize(m_nodes.size() + 8);
+		return firstChild;
+	}
 
-		if (movComp) {
-			entityVel = movComp->velocity;
+	int Octree::allocateEntityRecord(Entity* entity) {
+		int record;
+		if (!m_freeEntityRecords.empty()) {
+			record = m_freeEntityRecords.back();
+			m_freeEntityRecords.pop_back();
 		}
-
-		// Early exit if Bounding box doesn't collide with the current node
-		float tempCollisionTime = Intersection::continousSAT(entityBoundingBox, nodeBoundingBox, entityVel, glm::vec3(0.f), dt);
-		if (tempCollisionTime < 0.f || tempCollisionTime > collisionTime) {
-			return;
+		else {
+			record = (int)m_entityRecords.size();
+			m_entityRecords.emplace_back();
 		}
 
-		glm::vec3 otherEntityVel;
-
-		//Check against entities
-		for (auto& e : currentNode->entities) {
-			//Don't let an entity collide with itself
-			if (entity->getId() == e->getId()) {
-				continue;
-			}
+		m_entityRecords[record] = EntityRecord();
+		m_entityRecords[record].entity = entity;
+		return record;
+	}
 
-			Box* otherBoundingBox = e->getComponent<BoundingBoxComponent>()->getBoundingBox();
-			MovementComponent* otherMovComp = e->getComponent<MovementComponent>();
+	void Octree::linkEntityRecord(int record, int node) {
+		// Append to the end of the node's list so entities are visited in the order they were added
+		EntityRecord& entityRecord = m_entityRecords[record];
+		Node& currentNode = m_nodes[node];
 
-			if (otherMovComp) {
-				otherEntityVel = otherMovComp->velocity;
-			}
-			else {
-				otherEntityVel = { 0.f, 0.f, 0.f };
-			}
+		entityRecord.node = node;
+		entityRecord.previous = currentNode.lastEntity;
+		entityRecord.next = -1;
 
-			tempCollisionTime = Intersection::continousSAT(entityBoundingBox, otherBoundingBox, entityVel, otherEntityVel, dt);
-			// continue if Bounding box doesn't collide with entity bounding box
-			if (tempCollisionTime < 0.f || tempCollisionTime > collisionTime) {
-				continue;
-			}
+		if (currentNode.lastEntity >= 0) {
+			m_entityRecords[currentNode.lastEntity].next = record;
+		}
+		else {
+			currentNode.firstEntity = record;
+		}
+		currentNode.lastEntity = record;
+		currentNode.nrOfEntities++;
 
-			// Get collision
-			const MeshComponent* mesh = e->getComponent<MeshComponent>();
-			TransformComponent* transform = e->getComponent<TransformComponent>();
-			const CollidableComponent* collidable = e->getComponent<CollidableComponent>();
+		for (int i = node; i >= 0; i = m_nodes[i].parentNode) {
+			m_nodes[i].nrOfEntitiesInSubtree++;
+		}
+	}
 
-			if (mesh && !(doSimpleCollisions && collidable->allowSimpleCollision)) {
-				// Entity has a model. Check collision with meshes
-				glm::mat4 transformMatrix(1.0f);
-				if (transform) {
-					transformMatrix = transform->getMatrixWithUpdate();
-				}
+	void Octree::unlinkEntityRecord(int record) {
+		EntityRecord& entityRecord = m_entityRecords[record];
+		Node& currentNode = m_nodes[entityRecord.node];
 
-				entityBoundingBox->setMatrix(glm::inverse(transformMatrix));
+		if (entityRecord.previous >= 0) {
+			m_entityRecords[entityRecord.previous].next = entityRecord.next;
+		}
+		else {
+			currentNode.firstEntity = entityRecord.next;
+		}
 
-				//Convert velocities to local space for mesh
-				glm::vec3 zeroPoint = glm::inverse(transformMatrix) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
-				glm::vec3 newEntityVel = glm::inverse(transformMatrix) * glm::vec4(entityVel, 1.0f);
-				newEntityVel = newEntityVel - zeroPoint;
-				otherEntityVel = glm::inverse(transformMatrix) * glm::vec4(otherEntityVel, 1.0f);
-				otherEntityVel = otherEntityVel - zeroPoint;
-				//glm::vec3 newEntityVel = entityVel;
+		if (entityRecord.next >= 0) {
+			m_entityRecords[entityRecord.next].previous = entityRecord.previous;
+		}
+		else {
+			currentNode.lastEntity = entityRecord.previous;
+		}
 
-				// Get triangles to test continous collision against from narrow phase octree in mesh
-				std::vector<int> triangles;
-				mesh->mesh->getTrianglesForContinousCollisionTesting(triangles, entityBoundingBox, newEntityVel, otherEntityVel, dt);
+		currentNode.nrOfEntities--;
+		currentNode.nrOfEntitiesInSubtree--;
 
-				// Triangle to set mesh data to avoid creating new shapes for each triangle in mesh
-				Triangle triangle(glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.0f));
+		// The children of the ancestors can end up empty, remember them for the next prune
+		for (int i = currentNode.parentNode; i >= 0; i = m_nodes[i].parentNode) {
+			Node& ancestor = m_nodes[i];
+			ancestor.nrOfEntitiesInSubtree--;
+			if (ancestor.nrOfEntitiesInSubtree == ancestor.nrOfEntities) {
+				m_nodesToPrune.push_back(i);
+			}
+		}
 
-				//for (unsigned int j = 0; j < model->getModel()->getNumberOfMeshes(); j++) {
-				int numTriangles = triangles.size();
-				bool hasIndices = mesh->mesh->getNumberOfIndices() > 0;
-				bool hasVertices = mesh->mesh->getNumberOfVertices() > 0;
+		entityRecord.node = -1;
+		entityRecord.previous = -1;
+		entityRecord.next = -1;
+	}
 
-				for (int j = 0; j < numTriangles; j++) {
-					if (hasIndices) { // Has indices
-						triangle.setData(mesh->mesh->getVertexPosition(mesh->mesh->getVertexIndex(triangles[j])), mesh->mesh->getVertexPosition(mesh->mesh->getVertexIndex(triangles[j] + 1)), mesh->mesh->getVertexPosition(mesh->mesh->getVertexIndex(triangles[j] + 2)));
-					}
-					else if (hasVertices) {
-						triangle.setData(mesh->mesh->getVertexPosition(triangles[j]), mesh->mesh->getVertexPosition(triangles[j] + 1), mesh->mesh->getVertexPosition(triangles[j] + 2));
-					}
-					//triangle.setBaseMatrix(transformMatrix);
+	void Octree::getNextContinousCollisionRec(Entity* entity, Box* entityBoundingBox, const glm::vec3& entityMin, const glm::vec3& entityMax, const glm::vec3& entityVel, int currentNode, std::vector<CollisionInfo>& collisionInfo, float& collisionTime, std::vector<CollisionInfo>& zeroDistances, const float& dt, const bool doSimpleCollisions) {
+		const Node& node = m_nodes[currentNode];
 
-					float time = Intersection::continousSAT(entityBoundingBox, &triangle, newEntityVel, otherEntityVel, dt);
+		// Early exit if Bounding box doesn't collide with the current node
+		float tempCollisionTime = Intersection::continousAABB(entityMin, entityMax, node.center - node.halfSize, node.center + node.halfSize, entityVel, glm::vec3(0.f), dt);
+		if (tempCollisionTime < 0.f || tempCollisionTime > collisionTime) {
+			return;
+		}
 
-					if (time > 0.f && time < collisionTime) {
-						collisionInfo.clear();
-						collisionTime = time;
-						collisionInfo.emplace_back();
-						collisionInfo.back().entity = e;
-						collisionInfo.back().shape = std::make_shared<Triangle>(triangle);
-						collisionInfo.back().shape->setBaseMatrix(transformMatrix);
-					}
-					else if (time == collisionTime) {
-						collisionInfo.emplace_back();
-						collisionInfo.back().entity = e;
-						collisionInfo.back().shape = std::make_shared<Triangle>(triangle);
-						collisionInfo.back().shape->setBaseMatrix(transformMatrix);
-					}
-					else if (time == 0.f) {
-						zeroDistances.emplace_back();
-						zeroDistances.back().entity = e;
-						zeroDistances.back().shape = std::make_shared<Triangle>(triangle);
-						zeroDistances.back().shape->setBaseMatrix(transformMatrix);
-					}
-				}
-				//}
+		//Check against entities
+		for (int record = node.firstEntity; record >= 0; record = m_entityRecords[record].next) {
+			collideWithEntity(entity, entityBoundingBox, entityVel, m_entityRecords[record].entity, collisionInfo, collisionTime, zeroDistances, dt, doSimpleCollisions);
+		}
 
-				entityBoundingBox->setMatrix(glm::mat4(1.0f)); //Reset bounding box matrix to identity
-			}
-			else { // No model or simple collision opportunity
-				if (tempCollisionTime > 0.f && tempCollisionTime < collisionTime) {
-					// Collide with bounding box
-					collisionTime = tempCollisionTime;
-					collisionInfo.clear();
-					collisionInfo.emplace_back();
-					collisionInfo.back().entity = e;
-					collisionInfo.back().shape = std::make_shared<Box>(*otherBoundingBox);
-				}
-				else if (tempCollisionTime == collisionTime) {
-					collisionInfo.emplace_back();
-					collisionInfo.back().entity = e;
-					collisionInfo.back().shape = std::make_shared<Box>(*otherBoundingBox);
-				}
-				else if (tempCollisionTime == 0.f) {
-					zeroDistances.emplace_back();
-					zeroDistances.back().entity = e;
-					zeroDistances.back().shape = std::make_shared<Box>(*otherBoundingBox);
-				}
+		//Check for children
+		if (node.firstChild >= 0) {
+			for (int i = 0; i < 8; i++) {
+				getNextContinousCollisionRec(entity, entityBoundingBox, entityMin, entityMax, entityVel, node.firstChild + i, collisionInfo, collisionTime, zeroDistances, dt, doSimpleCollisions);
 			}
 		}
+	}
+
+	void Octree::getEntitiesInAabbRec(const glm::vec3& min, const glm::vec3& max, int currentNode, std::vector<Entity*>& outEntities) {
+		const Node& node = m_nodes[currentNode];
+		if (!aabbsOverlap(min, max, node.center - node.halfSize, node.center + node.halfSize)) {
+			return;
+		}
 
-		//Check for children
-		for (auto& it : currentNode->childNodes) {
-			getNextContinousCollisionRec(entity, &it, collisionInfo, collisionTime, zeroDistances, dt, doSimpleCollisions, checkBackfaces);
+		for (int record = node.firstEntity; record >= 0; record = m_entityRecords[record].next) {
+			outEntities.push_back(m_entityRecords[record].entity);
+		}
+
+		if (node.firstChild >= 0) {
+			for (int i = 0; i < 8; i++) {
+				getEntitiesInAabbRec(min, max, node.firstChild + i, outEntities);
+			}
 		}
 	}
 
-	void Octree::getRayIntersectionRec(Ray* ray, Node* currentNode, RayIntersectionInfo* outIntersectionData, Entity* ignoreThis, const bool doSimpleIntersections, const bool checkBackfaces) {
+	void Octree::getRayIntersectionRec(Ray* ray, int currentNode, RayIntersectionInfo* outIntersectionData, Entity* ignoreThis, const bool doSimpleIntersections) {
 
-		const Box* nodeBoundingBox = currentNode->nodeBB;
+		const Node& node = m_nodes[currentNode];
 		glm::vec3& rayDir = ray->getNormals()[0];
+		const glm::vec3& rayStart = ray->getVertices()[0];
 
-		float nodeIntersectionDistance = Intersection::continousSAT(ray, currentNode->nodeBB, rayDir, glm::vec3(0.f), INFINITY);
+		float nodeIntersectionDistance = Intersection::continousAABB(rayStart, rayStart, node.center - node.halfSize, node.center + node.halfSize, rayDir, glm::vec3(0.f), INFINITY);
 		// Early exit if ray doesn't intersect with the current node closer than the closest hit
 		if (nodeIntersectionDistance < 0.0f && (nodeIntersectionDistance < outIntersectionData->closestHit || outIntersectionData->closestHit < 0.0f)) {
 			return;
 		}
 
 		//Check against entities
-		for (int i = 0; i < currentNode->nrOfEntities; i++) {
-			if (ignoreThis && currentNode->entities[i]->getId() == ignoreThis->getId()) {
-				continue;
-			}
-
-			Box* collidableBoundingBox = currentNode->entities[i]->getComponent<BoundingBoxComponent>()->getBoundingBox();
-			glm::vec3 intersectionAxis;
-			float entityIntersectionDistance = Intersection::continousSAT(ray, collidableBoundingBox, rayDir, glm::vec3(0.f), INFINITY);
-
-			// Continue if ray doesn't intersect the entity bounding box closer than the closest hit
-			if (entityIntersectionDistance < 0.0f && (entityIntersectionDistance < outIntersectionData->closestHit || outIntersectionData->closestHit < 0.0f)) {
-				continue;
-			}
-
-			//Get Intersection
-			const MeshComponent* mesh = currentNode->entities[i]->getComponent<MeshComponent>();
-			TransformComponent* transform = currentNode->entities[i]->getComponent<TransformComponent>();
-			const CollidableComponent* collidable = currentNode->entities[i]->getComponent<CollidableComponent>();
-
-			if (mesh && !(doSimpleIntersections && collidable->allowSimpleCollision)) {
-				// Entity has a model. Check collision with meshes
-				glm::mat4 transformMatrix(1.0f);
-				if (transform) {
-					transformMatrix = transform->getMatrixWithUpdate();
-				}
-
-				ray->setMatrix(glm::inverse(transformMatrix));
-
-				//Convert velocities to local space for mesh
-				glm::vec3 zeroPoint = glm::inverse(transformMatrix) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
-				glm::vec3 newRayDir = glm::inverse(transformMatrix) * glm::vec4(rayDir, 1.0f);
-				newRayDir = newRayDir - zeroPoint;
-				glm::vec3 otherEntityVel = glm::inverse(transformMatrix) * glm::vec4(0.f, 0.f, 0.f, 1.0f);
-				otherEntityVel = otherEntityVel - zeroPoint;
-
-				// Get triangles to test continous collision against from narrow phase octree in mesh
-				std::vector<int> triangles;
-				mesh->mesh->getTrianglesForContinousCollisionTesting(triangles, ray, newRayDir, otherEntityVel, INFINITY);
-
-				// Triangle to set mesh data to avoid creating new shapes for each triangle in mesh
-				Triangle triangle(glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.0f));
-
-				//for (unsigned int j = 0; j < model->getModel()->getNumberOfMeshes(); j++) {
-				int numTriangles = triangles.size();
-				bool hasIndices = mesh->mesh->getNumberOfIndices() > 0;
-				bool hasVertices = mesh->mesh->getNumberOfVertices() > 0;
-
-				for (int j = 0; j < numTriangles; j++) {
-					if (hasIndices) { // Has indices
-						triangle.setData(mesh->mesh->getVertexPosition(mesh->mesh->getVertexIndex(triangles[j])), mesh->mesh->getVertexPosition(mesh->mesh->getVertexIndex(triangles[j] + 1)), mesh->mesh->getVertexPosition(mesh->mesh->getVertexIndex(triangles[j] + 2)));
-					}
-					else if (hasVertices) {
-						triangle.setData(mesh->mesh->getVertexPosition(triangles[j]), mesh->mesh->getVertexPosition(triangles[j] + 1), mesh->mesh->getVertexPosition(triangles[j] + 2));
-					}
-
-					float distance = Intersection::continousSAT(ray, &triangle, newRayDir, otherEntityVel, INFINITY);
-
-					if (distance > 0.f && (distance < outIntersectionData->closestHit || outIntersectionData->closestHit < 0.f)) {
-						outIntersectionData->closestHit = distance;
-						outIntersectionData->entity = currentNode->entities[i];
-					}
-				}
-				//}
-
-				ray->setMatrix(glm::mat4(1.0f)); //Reset bounding box matrix to identity
-			}
-			else { // No model or simple collision opportunity
-				if (entityIntersectionDistance > 0.f && entityIntersectionDistance < outIntersectionData->closestHit) {
-					outIntersectionData->closestHit = entityIntersectionDistance;
-					outIntersectionData->entity = currentNode->entities[i];
-				}
-			}
+		for (int record = node.firstEntity; record >= 0; record = m_entityRecords[record].next) {
+			intersectRayWithEntity(ray, m_entityRecords[record].entity, outIntersectionData, ignoreThis, doSimpleIntersections);
 		}
 
 		//Check for children
-		for (unsigned int i = 0; i < currentNode->childNodes.size(); i++) {
-			getRayIntersectionRec(ray, &currentNode->childNodes[i], outIntersectionData, ignoreThis, doSimpleIntersections, checkBackfaces);
+		if (node.firstChild >= 0) {
+			for (int i = 0; i < 8; i++) {
+				getRayIntersectionRec(ray, node.firstChild + i, outIntersectionData, ignoreThis, doSimpleIntersections);
+			}
 		}
 	}
 
-	int Octree::pruneTreeRec(Node* currentNode) {
-		int returnValue = 0;
-
-		if (currentNode->childNodes.size() > 0) { //Not a leaf node
-			//Call for child nodes
-			for (unsigned int i = 0; i < currentNode->childNodes.size(); i++) {
-				returnValue += pruneTreeRec(&currentNode->childNodes[i]);
-			}
-
-			if (returnValue == 0) {
-				//No entities in any child - Prune the children
-				for (unsigned int i = 0; i < currentNode->childNodes.size(); i++) {
-					delete currentNode->childNodes[i].nodeBB;
-				}
-				currentNode->childNodes.clear();
+	void Octree::pruneNodes() {
+		for (int node : m_nodesToPrune) {
+			// Entities can have been added again since the node was queued
+			int firstChild = m_nodes[node].firstChild;
+			if (firstChild >= 0 && m_nodes[node].nrOfEntitiesInSubtree == m_nodes[node].nrOfEntities) {
+				//No entities in any child - Prune the children. Their blocks are reused the next time a node is split
+				freeChildBlockRec(firstChild);
+				m_nodes[node].firstChild = -1;
 			}
 		}
 
-		returnValue += currentNode->nrOfEntities;
-
-		return returnValue;
+		m_nodesToPrune.clear();
 	}
 
-	void Octree::clean(Node* currentNode) {
-		for (size_t i = 0; i < currentNode->childNodes.size(); i++) {
-			clean(&currentNode->childNodes[i]);
+	void Octree::freeChildBlockRec(int firstChild) {
+		for (int i = 0; i < 8; i++) {
+			int childsFirstChild = m_nodes[firstChild + i].firstChild;
+			if (childsFirstChild >= 0) {
+				freeChildBlockRec(childsFirstChild);
+				m_nodes[firstChild + i].firstChild = -1;
+			}
 		}
-		delete currentNode->nodeBB;
+
+		m_freeChildBlocks.push_back(firstChild);
 	}
 
 	/*int Octree::frustumCulledDrawRec(const Frustum& frustum, Node* currentNode) {
@@ -502,60 +433,71 @@ namespace Scuffed {
 	}*/
 
 	void Octree::addEntity(Entity* newEntity) {
-		/*m_baseNode.entities.emplace_back(newEntity);
-		m_baseNode.nrOfEntities++;*/
+		if (hasEntity(newEntity)) {
+			// Already in the tree
+			return;
+		}
 
-		
-		// See if the base node needs to be bigger
-		glm::vec3 directionVec = findCornerOutside(newEntity, &m_baseNode);
+		int record = allocateEntityRecord(newEntity);
+		m_entityRecordIndices.set(newEntity->getId(), record);
 
-		if (glm::length(directionVec) != 0.0f) {
-			// Entity is outside base node
-			// Create bigger base node
-			expandBaseNode(directionVec);
-			// Recall this function to try to add the mesh again
-			addEntity(newEntity);
-		}
-		else {
-			addEntityRec(newEntity, &m_baseNode);
-		}
-		
+		addEntityFromBaseNode(record);
 	}
 
-	void Octree::addEntities(std::vector<Entity*>* newEntities) {
-		for (unsigned int i = 0; i < newEntities->size(); i++) {
-			addEntity(newEntities->at(i));
+	void Octree::removeEntity(Entity* entityToRemove) {
+		int id = entityToRemove->getId();
+		int record = m_entityRecordIndices.get(id);
+		if (record < 0) {
+			return;
 		}
+
+		unlinkEntityRecord(record);
+		m_entityRecords[record].entity = nullptr;
+		m_freeEntityRecords.push_back(record);
+		m_entityRecordIndices.remove(id);
 	}
 
-	void Octree::removeEntity(Entity* entityToRemove) {
-		removeEntityRec(entityToRemove, &m_baseNode);
+	bool Octree::hasEntity(Entity* entity) const {
+		return m_entityRecordIndices.get(entity->getId()) >= 0;
 	}
 
-	void Octree::removeEntities(std::vector<Entity*> entitiesToRemove) {
-		for (unsigned int i = 0; i < entitiesToRemove.size(); i++) {
-			removeEntity(entitiesToRemove[i]);
+	void Octree::update(const float /*dt*/) {
+		for (size_t i = 0; i < m_entityRecords.size(); i++) {
+			Entity* entity = m_entityRecords[i].entity;
+			if (entity && hasChanged(entity)) { //Entity has changed
+				//Move the entity if it doesn't belong in its node anymore
+				updateEntity((int)i);
+			}
 		}
-	}
 
-	void Octree::update() {
-		std::vector<Entity*> entitiesToReAdd;
-		updateRec(&m_baseNode, &entitiesToReAdd);
+		pruneNodes();
+	}
 
-		addEntities(&entitiesToReAdd);
+	void Octree::beginConcurrentQueries() {
+		// Warm the lazily updated data of everything in the tree so queries only read
+		for (auto& record : m_entityRecords) {
+			if (record.entity) {
+				warmCachedData(record.entity);
+			}
+		}
+		m_concurrentQueries = true;
+	}
 
-		entitiesToReAdd.clear();
+	void Octree::getNextContinousCollision(Entity* entity, Box* entityBoundingBox, const glm::vec3& entityVel, std::vector<CollisionInfo>& outCollisionInfo, float& collisionTime, std::vector<CollisionInfo>& zeroDistances, const float& dt, const bool doSimpleCollisions, const bool /*checkBackfaces*/) {
+		// Nodes are axis aligned so they are tested against the axis aligned box around the entity's bounding box
+		glm::vec3 entityMin, entityMax;
+		getAabb(entityBoundingBox, entityMin, entityMax);
 
-		pruneTreeRec(&m_baseNode);
+		getNextContinousCollisionRec(entity, entityBoundingBox, entityMin, entityMax, entityVel, 0, outCollisionInfo, collisionTime, zeroDistances, dt, doSimpleCollisions);
 	}
 
-	void Octree::getNextContinousCollision(Entity* entity, std::vector<CollisionInfo>& outCollisionInfo, float& collisionTime, std::vector<CollisionInfo>& zeroDistances, const float& dt, const bool doSimpleCollisions, const bool checkBackfaces) {
-		getNextContinousCollisionRec(entity, &m_baseNode, outCollisionInfo, collisionTime, zeroDistances, dt, doSimpleCollisions, checkBackfaces);
+	void Octree::getRayIntersection(const glm::vec3& rayStart, const glm::vec3& rayDir, RayIntersectionInfo* outIntersectionData, Entity* ignoreThis, const bool doSimpleIntersections, const bool /*checkBackfaces*/) {
+		Ray ray(rayStart, rayDir);
+		getRayIntersectionRec(&ray, 0, outIntersectionData, ignoreThis, doSimpleIntersections);
 	}
 
-	void Octree::getRayIntersection(const glm::vec3& rayStart, const glm::vec3& rayDir, RayIntersectionInfo* outIntersectionData, Entity* ignoreThis, const bool doSimpleIntersections, const bool checkBackfaces) {
-		Ray ray(rayStart, rayDir);
-		getRayIntersectionRec(&ray, &m_baseNode, outIntersectionData, ignoreThis, doSimpleIntersections, checkBackfaces);
+	void Octree::getEntitiesInAabb(const glm::vec3& min, const glm::vec3& max, std::vector<Entity*>& outEntities) {
+		getEntitiesInAabbRec(min, max, 0, outEntities);
 	}
 
 	//int Octree::frustumCulledDraw(Camera& camera) {
@@ -3,53 +3,42 @@
 #include <glm/glm.hpp>
 #include <vector>
 
+#include "Broadphase.h"
+
 namespace Scuffed {
 
-	class Box;
 	class Model;
 	class Entity;
-	class Shape;
 	class Ray;
 
-	class Octree {
-	public:
-		class CollisionInfo {
-		public:
-			CollisionInfo() {
-				intersectionAxis = { 0.0f, 0.0f, 0.0f };
-				intersectionDepth = 0.f;
-				//intersectionPosition = { 0.0f, 0.0f, 0.0f };
-				entity = nullptr;
-				shape = nullptr;
-			};
-
-			virtual ~CollisionInfo() {
-
-			};
-
-			glm::vec3 intersectionAxis;
-			float intersectionDepth;
-			//glm::vec3 intersectionPosition;
-			Entity* entity;
-			std::shared_ptr<Shape> shape;
-		};
-
-		struct RayIntersectionInfo {
-			float closestHit = -1.0f;
-			Entity* entity;
-		};
-
+	class Octree : public Broadphase {
 	private:
+		// All nodes live in m_nodes and refer to each other by index, so growing and pruning the tree never allocates per node
 		struct Node {
-			std::vector<Node> childNodes;
-			Node* parentNode = nullptr;
-			Box* nodeBB = nullptr;
+			glm::vec3 center = glm::vec3(0.f);
 			glm::vec3 halfSize = glm::vec3(0.f);
+			int parentNode = -1;
+			int firstChild = -1; // The 8 children are stored next to each other, -1 for leaf nodes
+			int firstEntity = -1; // Linked list of EntityRecords, -1 if the node is empty
+			int lastEntity = -1;
 			int nrOfEntities = 0;
-			std::vector<Entity*> entities;
+			int nrOfEntitiesInSubtree = 0; // Entities in this node and all nodes below it
 		};
 
-		Node m_baseNode;
+		// An entity in the tree. The records of all nodes share m_entityRecords
+		struct EntityRecord {
+			Entity* entity = nullptr;
+			int node = -1;
+			int previous = -1;
+			int next = -1;
+		};
+
+		std::vector<Node> m_nodes; // m_nodes[0] is the base node
+		std::vector<int> m_freeChildBlocks; // First index of each pruned block of 8 nodes
+		std::vector<EntityRecord> m_entityRecords;
+		std::vector<int> m_freeEntityRecords;
+		IdMap m_entityRecordIndices; // Entity id -> index in m_entityRecords, -1 if the entity is not in the tree
+		std::vector<int> m_nodesToPrune; // Nodes whose children might have become empty since the last update
 
 		Model* m_boundingBoxModel;
 
@@ -57,36 +46,46 @@ namespace Scuffed {
 		float m_minimumNodeHalfSize;
 
 		void expandBaseNode(glm::vec3 direction);
-		glm::vec3 findCornerOutside(Entity* entity, Node* testNode);
-		bool addEntityRec(Entity* newEntity, Node* currentNode);
-		bool removeEntityRec(Entity* entityToRemove, Node* currentNode);
-		void updateRec(Node* currentNode, std::vector<Entity*>* entitiesToReAdd);
+		glm::vec3 findCornerOutside(Entity* entity, int testNode);
+		bool isInsideNode(Entity* entity, int testNode);
+		bool addEntityRec(int record, int currentNode);
+		void addEntityFromBaseNode(int record);
+		void updateEntity(int record);
+
+		int allocateChildBlock();
+		int allocateEntityRecord(Entity* entity);
+		void linkEntityRecord(int record, int node);
+		void unlinkEntityRecord(int record);
 
-		void getNextContinousCollisionRec(Entity* entity, Node* currentNode, std::vector<CollisionInfo>& collisionInfo, float& collisionTime, std::vector<CollisionInfo>& zeroDistances, const float& dt = INFINITY, const bool doSimpleCollisions = false, const bool checkBackfaces = false);
+		void getNextContinousCollisionRec(Entity* entity, Box* entityBoundingBox, const glm::vec3& entityMin, const glm::vec3& entityMax, const glm::vec3& entityVel, int currentNode, std::vector<CollisionInfo>& collisionInfo, float& collisionTime, std::vector<CollisionInfo>& zeroDistances, const float& dt = INFINITY, const bool doSimpleCollisions = false);
 
-		void getRayIntersectionRec(Ray* ray, Node* currentNode, RayIntersectionInfo* outIntersectionData, Entity* ignoreThis, const bool doSimpleIntersections, const bool checkBackfaces);
+		void getEntitiesInAabbRec(const glm::vec3& min, const glm::vec3& max, int currentNode, std::vector<Entity*>& outEntities);
+		void getRayIntersectionRec(Ray* ray, int currentNode, RayIntersectionInfo* outIntersectionData, Entity* ignoreThis, const bool doSimpleIntersections);
 		
-		int pruneTreeRec(Node* currentNode);
+		void pruneNodes();
+		void freeChildBlockRec(int firstChild);
 		//int frustumCulledDrawRec(const Frustum& frustum, Node* currentNode);
 
-		void clean(Node* currentNode);
-
 	public:
 		Octree(Model* boundingBoxModel = nullptr);
 		virtual ~Octree();
 
 		virtual void addEntity(Entity* newEntity);
-		virtual void addEntities(std::vector<Entity*>* newEntities);
-
 		virtual void removeEntity(Entity* entityToRemove);
-		virtual void removeEntities(std::vector<Entity*> entitiesToRemove);
+		virtual bool hasEntity(Entity* entity) const;
+
+		virtual void update(const float dt);
 
-		virtual void update();
+		virtual void beginConcurrentQueries();
 
-		virtual void getNextContinousCollision(Entity* entity, std::vector<CollisionInfo>& outCollisionInfo, float& collisionTime, std::vector<CollisionInfo>& zeroDistances, const float& dt = INFINITY, const bool doSimpleCollisions = false, const bool checkBackfaces = false);
+		using Broadphase::getNextContinousCollision;
+		virtual void getNextContinousCollision(Entity* entity, Box* entityBoundingBox, const glm::vec3& entityVel, std::vector<CollisionInfo>& outCollisionInfo, float& collisionTime, std::vector<CollisionInfo>& zeroDistances, const float& dt = INFINITY, const bool doSimpleCollisions = false, const bool checkBackfaces = false);
 		virtual void getRayIntersection(const glm::vec3& rayStart, const glm::vec3& rayDir, RayIntersectionInfo* outIntersectionData, Entity* ignoreThis = nullptr, const bool doSimpleIntersections = false, const bool checkBackfaces = false);
 
 		//int frustumCulledDraw(Camera& camera);
+
+	protected:
+		virtual void getEntitiesInAabb(const glm::vec3& min, const glm::vec3& max, std::vector<Entity*>& outEntities);
 	};
 
 }
\ No newline at end of file
@@ -1,26 +1,52 @@
 #include "../pch.h"
 
+#include <cmath>
+
 #include "Scene.h"
 #include "Octree.h"
+#include "AabbTree.h"
+#include "SweepAndPrune.h"
+#include "ComponentRegistry.h"
+#include "../Utils/ThreadPool.h"
 #include "../DataTypes/Entity.h"
+#include "../DataTypes/Mesh.h"
+#include "../Components/Components.h"
 #include "../Systems/Systems.h"
 
 namespace Scuffed {
 
 	Scene::Scene() {
-		m_octree = SN_NEW Octree();
+		m_componentRegistry = SN_NEW ComponentRegistry();
+		m_broadphase = SN_NEW Octree();
+		m_threadPool = SN_NEW ThreadPool();
+
+		m_fixedTimestep = 0.f;
+		m_maxSteps = 1;
+		m_accumulatedTime = 0.f;
+		m_interpolation = 1.f;
+		m_publishedInterpolation = 1.f;
+
+		m_sleepSystem = nullptr;
+		m_sleepSpeed = 0.f;
+		m_sleepTime = 0.f;
 
 		createSystems();
 	}
 
 	Scene::~Scene() {
+		if (m_pendingUpdate.valid()) {
+			m_pendingUpdate.wait();
+		}
+
 		for (auto e : m_entities) {
 			delete e.second;
 		}
 
 		deleteSystems();
 
-		delete m_octree;
+		delete m_threadPool;
+		delete m_broadphase;
+		delete m_componentRegistry;
 	}
 
 	int Scene::addEntity() {
@@ -36,6 +62,34 @@ namespace Scuffed {
 		return testId;
 	}
 
+	void Scene::removeEntity(int entityId) {
+		auto it = m_entities.find(entityId);
+		if (it != m_entities.end()) {
+			removeEntityFromSystems(it->second);
+			delete it->second;
+			m_entities.erase(it);
+		}
+	}
+
+	void Scene::removeEntities(const std::vector<int>& entityIds) {
+		std::vector<Entity*> entitiesToRemove;
+		entitiesToRemove.reserve(entityIds.size());
+
+		for (auto id : entityIds) {
+			auto it = m_entities.find(id);
+			if (it != m_entities.end()) {
+				entitiesToRemove.push_back(it->second);
+				m_entities.erase(it);
+			}
+		}
+
+		removeEntitiesFromSystems(entitiesToRemove);
+
+		for (auto e : entitiesToRemove) {
+			delete e;
+		}
+	}
+
 	Entity* Scene::getEntity(int entityId) {
 		if (m_entities.count(entityId) > 0) {
 			return m_entities[entityId];
@@ -45,18 +99,93 @@ namespace Scuffed {
 		}
 	}
 
-	Octree* Scene::getOctree() {
-		return m_octree;
+	Broadphase* Scene::getBroadphase() {
+		return m_broadphase;
+	}
+
+	void Scene::setBroadphase(Broadphases::types type) {
+		Broadphase* newBroadphase = nullptr;
+		switch (type) {
+		case Broadphases::Octree:
+			newBroadphase = SN_NEW Octree();
+			break;
+		case Broadphases::AabbTree:
+			newBroadphase = SN_NEW AabbTree();
+			break;
+		case Broadphases::SweepAndPrune:
+			newBroadphase = SN_NEW SweepAndPrune();
+			break;
+		default:
+			return;
+		}
+
+		// The systems hold on to the broadphase, recreate them and let them add all entities to the new one
+		deleteSystems();
+		delete m_broadphase;
+		m_broadphase = newBroadphase;
+		createSystems();
+
+		std::vector<Entity*> entities;
+		entities.reserve(m_entities.size());
+		for (auto& e : m_entities) {
+			entities.push_back(e.second);
+		}
+		addEntitiesToSystems(entities);
+	}
+
+	ComponentRegistry* Scene::getComponentRegistry() {
+		return m_componentRegistry;
+	}
+
+	void Scene::setNrOfThreads(int nrOfThreads) {
+		m_threadPool->setNrOfThreads(nrOfThreads);
+	}
+
+	int Scene::getNrOfThreads() const {
+		return m_threadPool->getNrOfThreads();
+	}
+
+	ThreadPool* Scene::getThreadPool() {
+		return m_threadPool;
+	}
+
+	void Scene::addLoadingMesh(int entityId) {
+		if (std::find(m_loadingMeshes.begin(), m_loadingMeshes.end(), entityId) == m_loadingMeshes.end()) {
+			m_loadingMeshes.push_back(entityId);
+		}
+	}
+
+	void Scene::finishMeshLoads() {
+		for (size_t i = 0; i < m_loadingMeshes.size(); i++) {
+			Entity* e = getEntity(m_loadingMeshes[i]);
+			MeshComponent* comp = e ? e->getComponent<MeshComponent>() : nullptr;
+
+			if (!comp || comp->mesh->finishLoading()) {
+				if (comp) {
+					// The bounding box has to be recalculated from the new vertices
+					comp->notifyChange();
+				}
+				m_loadingMeshes[i] = m_loadingMeshes.back();
+				m_loadingMeshes.pop_back();
+				i--;
+			}
+		}
 	}
 
 	void Scene::createSystems() {
+		// First, so the sleeping entities are taken out of the other systems before they run
+		m_sleepSystem = SN_NEW SleepSystem();
+		m_sleepSystem->provideScene(this);
+		m_sleepSystem->setSleepThresholds(m_sleepSpeed, m_sleepTime);
+		m_systems.push_back(m_sleepSystem);
+
 		m_systems.emplace_back();
 		m_systems.back() = SN_NEW UpdateBoundingBoxSystem();
 
 		m_systems.emplace_back();
 		m_systems.back() = SN_NEW OctreeAddRemoverSystem();
 
-		static_cast<OctreeAddRemoverSystem*>(m_systems.back())->provideOctree(m_octree);
+		static_cast<OctreeAddRemoverSystem*>(m_systems.back())->provideBroadphase(m_broadphase);
 
 		m_systems.emplace_back();
 		m_systems.back() = SN_NEW MovementSystem();
@@ -64,43 +193,297 @@ namespace Scuffed {
 		m_systems.emplace_back();
 		m_systems.back() = SN_NEW CollisionSystem();
 
-		static_cast<CollisionSystem*>(m_systems.back())->provideOctree(m_octree);
+		static_cast<CollisionSystem*>(m_systems.back())->provideBroadphase(m_broadphase);
 
 		m_systems.emplace_back();
 		m_systems.back() = SN_NEW MovementPostCollisionSystem();
 
 		m_systems.emplace_back();
 		m_systems.back() = SN_NEW SpeedLimitSystem();
+
+		for (auto sys : m_systems) {
+			sys->provideThreadPool(m_threadPool);
+			sys->provideComponentRegistry(m_componentRegistry);
+
+			const ComponentMask& required = sys->getRequiredComponentTypes();
+			for (int i = 0; i < Components::NUMBER_OF_TYPES; i++) {
+				if (required.test(i)) {
+					m_systemsByComponent[i].push_back(sys);
+				}
+			}
+		}
+
+		// A system has to wait for every earlier system that writes something it uses or uses something it writes.
+		// Systems without such a conflict can run at the same time
+		const size_t nrOfSystems = m_systems.size();
+		m_systemDependents.resize(nrOfSystems);
+		m_nrOfSystemDependencies.resize(nrOfSystems, 0);
+		for (size_t i = 0; i < nrOfSystems; i++) {
+			const ComponentMask& readI = m_systems[i]->getReadComponentTypes();
+			const ComponentMask& writtenI = m_systems[i]->getWrittenComponentTypes();
+
+			for (size_t j = i + 1; j < nrOfSystems; j++) {
+				const ComponentMask& readJ = m_systems[j]->getReadComponentTypes();
+				const ComponentMask& writtenJ = m_systems[j]->getWrittenComponentTypes();
+
+				if ((writtenI & (readJ | writtenJ)).any() || (readI & writtenJ).any()) {
+					m_systemDependents[i].push_back(j);
+					m_nrOfSystemDependencies[j]++;
+				}
+			}
+		}
 	}
 
 	void Scene::deleteSystems() {
 		for (auto s : m_systems) {
 			delete s;
 		}
+		m_systems.clear();
+		m_sleepSystem = nullptr;
+
+		for (int i = 0; i < Components::NUMBER_OF_TYPES; i++) {
+			m_systemsByComponent[i].clear();
+		}
+
+		m_systemDependents.clear();
+		m_nrOfSystemDependencies.clear();
+	}
+
+	void Scene::setFixedTimestep(float stepSize, int maxSteps) {
+		m_fixedTimestep = stepSize;
+		m_maxSteps = glm::max(maxSteps, 1);
+		m_accumulatedTime = 0.f;
+	}
+
+	float Scene::getInterpolation() const {
+		return m_publishedInterpolation;
+	}
+
+	void Scene::setSleepThresholds(float speed, float time) {
+		m_sleepSpeed = speed;
+		m_sleepTime = time;
+		m_sleepSystem->setSleepThresholds(speed, time);
+	}
+
+	void Scene::setSleeping(Entity* entity, bool sleeping) {
+		MovementComponent* movement = entity->getComponent<MovementComponent>();
+		if (!movement || movement->sleeping == sleeping) {
+			return;
+		}
+
+		movement->sleeping = sleeping;
+		for (auto sys : m_systems) {
+			if (sys->skipsSleepingEntities() && entity->hasComponents(sys->getRequiredComponentTypes())) {
+				if (sleeping) {
+					sys->removeEntity(entity);
+				}
+				else {
+					sys->addEntity(entity);
+				}
+			}
+		}
+	}
+
+	bool Scene::fitsSystem(Entity* entity, BaseSystem* system) {
+		if (!entity->hasComponents(system->getRequiredComponentTypes())) {
+			return false;
+		}
+
+		if (system->skipsSleepingEntities()) {
+			MovementComponent* movement = entity->getComponent<MovementComponent>();
+			return !movement || !movement->sleeping;
+		}
+		return true;
 	}
 
 	void Scene::update(float dt) {
-		for (auto s : m_systems) {
-			s->update(dt);
+		waitForUpdate();
+
+		prepareUpdate();
+		simulate(dt);
+		publishTransforms();
+	}
+
+	void Scene::updateAsync(float dt) {
+		waitForUpdate();
+
+		// Everything that reads what the client can write is done here, on the calling thread
+		prepareUpdate();
+		m_pendingUpdate = std::async(std::launch::async, [this, dt] {
+			simulate(dt);
+		});
+	}
+
+	bool Scene::isUpdateDone() {
+		return !m_pendingUpdate.valid() || m_pendingUpdate.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	}
+
+	void Scene::waitForUpdate() {
+		if (!m_pendingUpdate.valid()) {
+			return;
+		}
+
+		m_pendingUpdate.get();
+		publishTransforms();
+	}
+
+	void Scene::prepareUpdate() {
+		finishMeshLoads();
+
+		// Positions the client wrote through the bound pointers
+		ComponentPool<TransformComponent>* transforms = m_componentRegistry->getPool<TransformComponent>();
+		for (size_t i = 0; i < transforms->size(); i++) {
+			TransformComponent* transform = transforms->at(i);
+			if (transform->isBound()) {
+				transform->readBoundData();
+			}
+		}
+	}
+
+	void Scene::simulate(float dt) {
+		if (m_fixedTimestep <= 0.f) {
+			step(dt);
+			m_interpolation = 1.f;
+			return;
+		}
+
+		ComponentPool<TransformComponent>* transforms = m_componentRegistry->getPool<TransformComponent>();
+
+		m_accumulatedTime += dt;
+		for (int i = 0; i < m_maxSteps && m_accumulatedTime >= m_fixedTimestep; i++) {
+			for (size_t j = 0; j < transforms->size(); j++) {
+				TransformComponent* transform = transforms->at(j);
+				if (transform->isBound()) {
+					transform->saveStepStart();
+				}
+			}
+
+			step(m_fixedTimestep);
+			m_accumulatedTime -= m_fixedTimestep;
+		}
+
+		if (m_accumulatedTime >= m_fixedTimestep) {
+			// Too far behind to catch up, drop the whole steps that didn't fit instead of making the next calls even slower
+			m_accumulatedTime = std::fmod(m_accumulatedTime, m_fixedTimestep);
+		}
+
+		m_interpolation = m_accumulatedTime / m_fixedTimestep;
+	}
+
+	void Scene::publishTransforms() {
+		m_publishedInterpolation = m_interpolation;
+
+		ComponentPool<TransformComponent>* transforms = m_componentRegistry->getPool<TransformComponent>();
+		for (size_t i = 0; i < transforms->size(); i++) {
+			TransformComponent* transform = transforms->at(i);
+			if (transform->isBound()) {
+				transform->updateBoundData(m_interpolation);
+			}
 		}
 	}
 
+	void Scene::step(float dt) {
+		if (m_threadPool->getNrOfThreads() <= 1) {
+			for (auto s : m_systems) {
+				s->update(dt);
+			}
+			return;
+		}
+
+		// Run every system as a job as soon as the systems it depends on are done
+		std::vector<std::atomic<int>> dependenciesLeft(m_systems.size());
+		for (size_t i = 0; i < m_systems.size(); i++) {
+			dependenciesLeft[i] = m_nrOfSystemDependencies[i];
+		}
+
+		ThreadPool::Counter counter(0);
+		std::function<void(size_t)> runSystem = [&](size_t i) {
+			m_systems[i]->update(dt);
+
+			for (size_t dependent : m_systemDependents[i]) {
+				if (dependenciesLeft[dependent].fetch_sub(1) == 1) {
+					m_threadPool->submit([&runSystem, dependent] { runSystem(dependent); }, &counter);
+				}
+			}
+		};
+
+		for (size_t i = 0; i < m_systems.size(); i++) {
+			if (m_nrOfSystemDependencies[i] == 0) {
+				m_threadPool->submit([&runSystem, i] { runSystem(i); }, &counter);
+			}
+		}
+
+		m_threadPool->wait(&counter);
+	}
+
 	void Scene::addEntityToSystems(Entity* entity) {
 		// Check which systems this entity can be placed in
 		for (auto sys : m_systems) {
-			auto componentTypes = sys->getRequiredComponentTypes();
-
 			// Add this entity to the system
-			if (entity->hasComponents(componentTypes)) {
+			if (fitsSystem(entity, sys)) {
 				sys->addEntity(entity);
 			}
 		}
 	}
 
 	void Scene::removeEntityFromSystems(Entity* entity) {
+		if (m_sleepSystem) {
+			m_sleepSystem->prepareRemoval(entity);
+		}
+
 		for (auto sys : m_systems) {
 			sys->removeEntity(entity);
 		}
 	}
 
+	void Scene::addEntityToSystems(Entity* entity, int componentType) {
+		// Only systems requiring the new component can have started matching
+		for (auto sys : m_systemsByComponent[componentType]) {
+			if (fitsSystem(entity, sys)) {
+				sys->addEntity(entity);
+			}
+		}
+	}
+
+	void Scene::removeEntityFromSystems(Entity* entity, int componentType) {
+		// Whatever rested on the entity might not be able to anymore
+		if (m_sleepSystem) {
+			m_sleepSystem->wakeIslandsTouching(entity);
+		}
+
+		// Only systems requiring the component can have the entity, and only if it currently matches them
+		for (auto sys : m_systemsByComponent[componentType]) {
+			if (entity->hasComponents(sys->getRequiredComponentTypes())) {
+				sys->removeEntity(entity);
+			}
+		}
+	}
+
+	void Scene::addEntitiesToSystems(const std::vector<Entity*>& entities) {
+		std::vector<Entity*> matching;
+		matching.reserve(entities.size());
+
+		for (auto sys : m_systems) {
+			matching.clear();
+			for (auto e : entities) {
+				if (fitsSystem(e, sys)) {
+					matching.push_back(e);
+				}
+			}
+			sys->addEntities(matching);
+		}
+	}
+
+	void Scene::removeEntitiesFromSystems(const std::vector<Entity*>& entities) {
+		if (m_sleepSystem) {
+			for (auto e : entities) {
+				m_sleepSystem->prepareRemoval(e);
+			}
+		}
+
+		for (auto sys : m_systems) {
+			sys->removeEntities(entities);
+		}
+	}
+
 }
\ No newline at end of file
@@ -1,12 +1,20 @@
 #pragma once
 
+#include <future>
 #include <unordered_map>
+#include <vector>
+
+#include "../Components/Component.h"
+#include "Broadphase.h"
 
 namespace Scuffed {
 
-	class Octree;
+	class Broadphase;
 	class Entity;
 	class BaseSystem;
+	class SleepSystem;
+	class ComponentRegistry;
+	class ThreadPool;
 
 	class Scene {
 	public:
@@ -14,21 +22,89 @@ namespace Scuffed {
 		virtual ~Scene();
 
 		virtual int addEntity();
+		virtual void removeEntity(int entityId);
+		virtual void removeEntities(const std::vector<int>& entityIds);
 		virtual Entity* getEntity(int entityId);
-		virtual Octree* getOctree();
+		virtual Broadphase* getBroadphase();
+		// Replaces the broadphase, the entities are moved to the new one. Octree is the default
+		virtual void setBroadphase(Broadphases::types type);
+		virtual ComponentRegistry* getComponentRegistry();
+
+		// Number of threads used by the systems, including the thread calling update. 1 runs everything on the calling thread
+		virtual void setNrOfThreads(int nrOfThreads);
+		virtual int getNrOfThreads() const;
+		// Can only be used by the thread updating the scene, and not during update
+		virtual ThreadPool* getThreadPool();
+
+		// The entity's mesh is being built by Mesh::loadAsync. It starts being used by the first update after the build is done
+		virtual void addLoadingMesh(int entityId);
+
+		// Runs update in steps of stepSize, at most maxSteps per call. The time left over is kept for the next call, unless the scene has fallen more than maxSteps behind.
+		// The bound transforms then show the state that far between the last two steps. A stepSize of 0 (default) runs a single step of whatever dt update is given
+		virtual void setFixedTimestep(float stepSize, int maxSteps);
+		// How far between the last two steps the bound transforms are, 1 when not using a fixed timestep
+		virtual float getInterpolation() const;
+
+		// Islands of touching moving entities that have all moved slower than speed (units or radians per second) for time seconds fall asleep.
+		// Sleeping entities are skipped by the systems moving them until they are moved or given a velocity from the outside, an awake entity touches them, or something they touch is moved or removed.
+		// A time of 0 (default) turns sleeping off
+		virtual void setSleepThresholds(float speed, float time);
+		// Takes the entity out of or puts it back into the systems that skip sleeping entities. Used by the sleep system
+		virtual void setSleeping(Entity* entity, bool sleeping);
 
 		virtual void createSystems();
 		virtual void deleteSystems();
 		virtual void update(float dt);
+		// Runs update on another thread and returns immediately. Until waitForUpdate is called the scene may not be used,
+		// but the bound matrices and positions keep the state from the previous update and can be read in the meantime
+		virtual void updateAsync(float dt);
+		virtual bool isUpdateDone();
+		// Waits for the update started by updateAsync and then writes its result to the bound matrices and positions. Does nothing if no update is running
+		virtual void waitForUpdate();
 
 		virtual void addEntityToSystems(Entity* entity);
 		virtual void removeEntityFromSystems(Entity* entity);
+		// Incremental versions, only looks at the systems that require componentType.
+		// removeEntityFromSystems has to be called before the component is removed from the entity
+		virtual void addEntityToSystems(Entity* entity, int componentType);
+		virtual void removeEntityFromSystems(Entity* entity, int componentType);
+		// Batch versions, each system gets all of its entities in one call
+		virtual void addEntitiesToSystems(const std::vector<Entity*>& entities);
+		virtual void removeEntitiesFromSystems(const std::vector<Entity*>& entities);
 
 	private:
+		ComponentRegistry* m_componentRegistry;
 		std::unordered_map<int, Entity*> m_entities;
 		std::vector<BaseSystem*> m_systems;
+		std::vector<BaseSystem*> m_systemsByComponent[Components::NUMBER_OF_TYPES]; // Systems that require the component type
+		std::vector<std::vector<size_t>> m_systemDependents; // Indices of the systems that have to wait for the system
+		std::vector<int> m_nrOfSystemDependencies; // Number of systems the system has to wait for
+		SleepSystem* m_sleepSystem;
+		float m_sleepSpeed;
+		float m_sleepTime;
+
+		// If the entity should be in the system, from its components and whether it is sleeping
+		bool fitsSystem(Entity* entity, BaseSystem* system);
+
+		Broadphase* m_broadphase;
+		ThreadPool* m_threadPool;
+
+		std::vector<int> m_loadingMeshes;
+		void finishMeshLoads();
+
+		float m_fixedTimestep;
+		int m_maxSteps;
+		float m_accumulatedTime;
+		float m_interpolation;
+		float m_publishedInterpolation; // Interpolation of what the bound transforms show, m_interpolation can be changed by an update running on another thread
+		std::future<void> m_pendingUpdate;
 
-		Octree* m_octree;
+		// Update is split into the parts reading and writing what the client sees, which run on the calling thread, and simulate which can run on another thread
+		void prepareUpdate();
+		void simulate(float dt);
+		void step(float dt);
+		// Writes the transforms the client has bound pointers to, with the interpolation between the step start and the current state
+		void publishTransforms();
 	};
 
 }
\ No newline at end of file
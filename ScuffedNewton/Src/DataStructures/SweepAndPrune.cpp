@@ -0,0 +1,404 @@
+#include "../pch.h"
+
+#include <algorithm>
+
+#include "SweepAndPrune.h"
+#include "../Calculations/Intersection.h"
+#include "../DataTypes/Entity.h"
+#include "../Components/Components.h"
+#include "../Shapes/Box.h"
+#include "../Shapes/Ray.h"
+
+namespace Scuffed {
+
+	SweepAndPrune::SweepAndPrune() {
+		m_hasDeadEndpoints = false;
+		m_fatMargin = 0.2f;
+		m_sweepTime = 1.0f / 60.0f; // Until the first update
+	}
+
+	SweepAndPrune::~SweepAndPrune() {
+
+	}
+
+	void SweepAndPrune::getReachBox(Entity* entity, glm::vec3& outMin, glm::vec3& outMax) {
+		Box* boundingBox = entity->getComponent<BoundingBoxComponent>()->getBoundingBox();
+		MovementComponent* movement = entity->getComponent<MovementComponent>();
+		TransformComponent* transform = entity->getComponent<TransformComponent>();
+
+		if (!movement) {
+			getAabb(boundingBox, outMin, outMax);
+		}
+		else if (transform && glm::length2(movement->angularVelocity) > 0.f) {
+			getReach(boundingBox, movement->velocity, transform->getTranslation() + transform->getCenter(), movement->angularVelocity, m_sweepTime, outMin, outMax);
+		}
+		else {
+			getReach(boundingBox, movement->velocity, m_sweepTime, outMin, outMax);
+		}
+	}
+
+	void SweepAndPrune::fitBox(int box, const glm::vec3& min, const glm::vec3& max) {
+		SapBox& sapBox = m_boxes[box];
+		glm::vec3 oldMin = sapBox.min;
+		glm::vec3 oldMax = sapBox.max;
+		sapBox.min = min - glm::vec3(m_fatMargin);
+		sapBox.max = max + glm::vec3(m_fatMargin);
+
+		for (int axis = 0; axis < 3; axis++) {
+			m_endpoints[axis][sapBox.minEndpoints[axis]].value = sapBox.min[axis];
+			m_endpoints[axis][sapBox.maxEndpoints[axis]].value = sapBox.max[axis];
+
+			// Grow first so pairs are found before separations are removed
+			if (sapBox.min[axis] < oldMin[axis]) {
+				sortMinDown(axis, sapBox.minEndpoints[axis]);
+			}
+			if (sapBox.max[axis] > oldMax[axis]) {
+				sortMaxUp(axis, sapBox.maxEndpoints[axis]);
+			}
+			if (sapBox.min[axis] > oldMin[axis]) {
+				sortMinUp(axis, sapBox.minEndpoints[axis]);
+			}
+			if (sapBox.max[axis] < oldMax[axis]) {
+				sortMaxDown(axis, sapBox.maxEndpoints[axis]);
+			}
+		}
+	}
+
+	void SweepAndPrune::removeDeadEndpoints() {
+		for (int axis = 0; axis < 3; axis++) {
+			std::vector<Endpoint>& endpoints = m_endpoints[axis];
+			endpoints.erase(std::remove_if(endpoints.begin(), endpoints.end(), [](const Endpoint& endpoint) { return endpoint.box < 0; }), endpoints.end());
+
+			for (int i = 0; i < (int)endpoints.size(); i++) {
+				setEndpointIndex(axis, i);
+			}
+		}
+		m_hasDeadEndpoints = false;
+	}
+
+	bool SweepAndPrune::boxesOverlap(int box1, int box2) const {
+		const SapBox& b1 = m_boxes[box1];
+		const SapBox& b2 = m_boxes[box2];
+		return b1.min.x <= b2.max.x && b2.min.x <= b1.max.x &&
+			b1.min.y <= b2.max.y && b2.min.y <= b1.max.y &&
+			b1.min.z <= b2.max.z && b2.min.z <= b1.max.z;
+	}
+
+	void SweepAndPrune::addPair(int box1, int box2) {
+		std::vector<int>& overlaps1 = m_boxes[box1].overlaps;
+		if (std::find(overlaps1.begin(), overlaps1.end(), box2) != overlaps1.end()) {
+			// Already overlapping on the other axes
+			return;
+		}
+
+		overlaps1.push_back(box2);
+		m_boxes[box2].overlaps.push_back(box1);
+	}
+
+	void SweepAndPrune::removePair(int box1, int box2) {
+		std::vector<int>& overlaps1 = m_boxes[box1].overlaps;
+		auto it = std::find(overlaps1.begin(), overlaps1.end(), box2);
+		if (it == overlaps1.end()) {
+			return;
+		}
+		overlaps1.erase(it);
+
+		std::vector<int>& overlaps2 = m_boxes[box2].overlaps;
+		overlaps2.erase(std::find(overlaps2.begin(), overlaps2.end(), box1));
+	}
+
+	void SweepAndPrune::setEndpointIndex(int axis, int index) {
+		const Endpoint& endpoint = m_endpoints[axis][index];
+		if (endpoint.box < 0) {
+			return;
+		}
+
+		if (endpoint.isMin) {
+			m_boxes[endpoint.box].minEndpoints[axis] = index;
+		}
+		else {
+			m_boxes[endpoint.box].maxEndpoints[axis] = index;
+		}
+	}
+
+	void SweepAndPrune::swapEndpoints(int axis, int index1, int index2) {
+		std::swap(m_endpoints[axis][index1], m_endpoints[axis][index2]);
+		setEndpointIndex(axis, index1);
+		setEndpointIndex(axis, index2);
+	}
+
+	void SweepAndPrune::sortMinDown(int axis, int index) {
+		std::vector<Endpoint>& endpoints = m_endpoints[axis];
+		while (index > 0 && endpoints[index - 1].value > endpoints[index].value) {
+			const Endpoint& previous = endpoints[index - 1];
+			if (!previous.isMin && previous.box >= 0 && boxesOverlap(endpoints[index].box, previous.box)) {
+				// Moved past the end of another box, the boxes might overlap now
+				addPair(endpoints[index].box, previous.box);
+			}
+			swapEndpoints(axis, index - 1, index);
+			index--;
+		}
+	}
+
+	void SweepAndPrune::sortMinUp(int axis, int index) {
+		std::vector<Endpoint>& endpoints = m_endpoints[axis];
+		while (index + 1 < (int)endpoints.size() && endpoints[index + 1].value < endpoints[index].value) {
+			const Endpoint& next = endpoints[index + 1];
+			if (!next.isMin && next.box >= 0) {
+				// Moved past the end of another box, the boxes are separated on this axis
+				removePair(endpoints[index].box, next.box);
+			}
+			swapEndpoints(axis, index, index + 1);
+			index++;
+		}
+	}
+
+	void SweepAndPrune::sortMaxDown(int axis, int index) {
+		std::vector<Endpoint>& endpoints = m_endpoints[axis];
+		while (index > 0 && endpoints[index - 1].value > endpoints[index].value) {
+			const Endpoint& previous = endpoints[index - 1];
+			if (previous.isMin && previous.box >= 0) {
+				// Moved past the start of another box, the boxes are separated on this axis
+				removePair(endpoints[index].box, previous.box);
+			}
+			swapEndpoints(axis, index - 1, index);
+			index--;
+		}
+	}
+
+	void SweepAndPrune::sortMaxUp(int axis, int index) {
+		std::vector<Endpoint>& endpoints = m_endpoints[axis];
+		while (index + 1 < (int)endpoints.size() && endpoints[index + 1].value < endpoints[index].value) {
+			const Endpoint& next = endpoints[index + 1];
+			if (next.isMin && next.box >= 0 && boxesOverlap(endpoints[index].box, next.box)) {
+				// Moved past the start of another box, the boxes might overlap now
+				addPair(endpoints[index].box, next.box);
+			}
+			swapEndpoints(axis, index, index + 1);
+			index++;
+		}
+	}
+
+	void SweepAndPrune::addEntity(Entity* newEntity) {
+		if (hasEntity(newEntity)) {
+			// Already added
+			return;
+		}
+
+		int box;
+		if (!m_freeBoxes.empty()) {
+			box = m_freeBoxes.back();
+			m_freeBoxes.pop_back();
+		}
+		else {
+			box = (int)m_boxes.size();
+			m_boxes.emplace_back();
+		}
+		m_boxIndices.set(newEntity->getId(), box);
+
+		SapBox& newBox = m_boxes[box];
+		newBox.entity = newEntity;
+		getReachBox(newEntity, newBox.min, newBox.max);
+		newBox.min -= glm::vec3(m_fatMargin);
+		newBox.max += glm::vec3(m_fatMargin);
+
+		// Add the end points last on each axis and sort them into place
+		for (int axis = 0; axis < 3; axis++) {
+			std::vector<Endpoint>& endpoints = m_endpoints[axis];
+			int minIndex = (int)endpoints.size();
+			endpoints.push_back({ m_boxes[box].min[axis], box, true });
+			endpoints.push_back({ m_boxes[box].max[axis], box, false });
+			m_boxes[box].minEndpoints[axis] = minIndex;
+			m_boxes[box].maxEndpoints[axis] = minIndex + 1;
+
+			sortMinDown(axis, m_boxes[box].minEndpoints[axis]);
+			sortMaxDown(axis, m_boxes[box].maxEndpoints[axis]);
+		}
+	}
+
+	void SweepAndPrune::removeEntity(Entity* entityToRemove) {
+		int id = entityToRemove->getId();
+		int box = m_boxIndices.get(id);
+		if (box < 0) {
+			return;
+		}
+
+		SapBox& removedBox = m_boxes[box];
+
+		for (int other : removedBox.overlaps) {
+			std::vector<int>& otherOverlaps = m_boxes[other].overlaps;
+			otherOverlaps.erase(std::find(otherOverlaps.begin(), otherOverlaps.end(), box));
+		}
+		removedBox.overlaps.clear();
+
+		// The end points stay in place, so removing is constant time. They are taken out all at once by the next update
+		for (int axis = 0; axis < 3; axis++) {
+			m_endpoints[axis][removedBox.minEndpoints[axis]].box = -1;
+			m_endpoints[axis][removedBox.maxEndpoints[axis]].box = -1;
+		}
+		m_hasDeadEndpoints = true;
+
+		removedBox = SapBox();
+		m_freeBoxes.push_back(box);
+		m_boxIndices.remove(id);
+	}
+
+	bool SweepAndPrune::hasEntity(Entity* entity) const {
+		return m_boxIndices.get(entity->getId()) >= 0;
+	}
+
+	void SweepAndPrune::update(const float dt) {
+		m_sweepTime = dt;
+
+		if (m_hasDeadEndpoints) {
+			removeDeadEndpoints();
+		}
+
+		for (size_t i = 0; i < m_boxes.size(); i++) {
+			Entity* entity = m_boxes[i].entity;
+			if (!entity || !hasChanged(entity)) {
+				continue;
+			}
+
+			// Only move the end points if the entity has left its enlarged box
+			glm::vec3 min, max;
+			getReachBox(entity, min, max);
+			const SapBox& box = m_boxes[i];
+			if (glm::all(glm::greaterThanEqual(min, box.min)) && glm::all(glm::lessThanEqual(max, box.max))) {
+				continue;
+			}
+
+			fitBox((int)i, min, max);
+		}
+	}
+
+	void SweepAndPrune::beginConcurrentQueries() {
+		// Warm the lazily updated data of every entity so queries only read
+		for (auto& box : m_boxes) {
+			if (box.entity) {
+				warmCachedData(box.entity);
+			}
+		}
+		m_concurrentQueries = true;
+	}
+
+	void SweepAndPrune::getNextContinousCollision(Entity* entity, Box* entityBoundingBox, const glm::vec3& entityVel, std::vector<CollisionInfo>& outCollisionInfo, float& collisionTime, std::vector<CollisionInfo>& zeroDistances, const float& dt, const bool doSimpleCollisions, const bool /*checkBackfaces*/) {
+		glm::vec3 entityMin, entityMax;
+		getAabb(entityBoundingBox, entityMin, entityMax);
+
+		int box = m_boxIndices.get(entity->getId());
+
+		if (box >= 0 && dt < INFINITY) {
+			glm::vec3 movedDistance = entityVel * dt;
+			glm::vec3 sweptMin = glm::min(entityMin, entityMin + movedDistance);
+			glm::vec3 sweptMax = glm::max(entityMax, entityMax + movedDistance);
+
+			const SapBox& entityBox = m_boxes[box];
+			if (glm::all(glm::greaterThanEqual(sweptMin, entityBox.min)) && glm::all(glm::lessThanEqual(sweptMax, entityBox.max))) {
+				// The movement is covered by the entity's box, so only the boxes overlapping it can be hit
+				for (int other : entityBox.overlaps) {
+					collideWithEntity(entity, entityBoundingBox, entityVel, m_boxes[other].entity, outCollisionInfo, collisionTime, zeroDistances, dt, doSimpleCollisions);
+				}
+				return;
+			}
+		}
+
+		// The entity is not in the structure or moves further than its box covers, test against all boxes
+		for (auto& other : m_boxes) {
+			if (!other.entity) {
+				continue;
+			}
+
+			float time = Intersection::continousAABB(entityMin, entityMax, other.min, other.max, entityVel, glm::vec3(0.f), dt);
+			if (time < 0.f || time > collisionTime) {
+				continue;
+			}
+
+			collideWithEntity(entity, entityBoundingBox, entityVel, other.entity, outCollisionInfo, collisionTime, zeroDistances, dt, doSimpleCollisions);
+		}
+	}
+
+	void SweepAndPrune::getPairs(const std::vector<Entity*>& movingEntities, const std::vector<glm::vec3>& reachMins, const std::vector<glm::vec3>& reachMaxes, std::vector<EntityPair>& outPairs) {
+		setMovingEntityIndices(movingEntities);
+
+		// The boxes are usually fitted to the reach already by update. Velocities changed since then or a different dt can leave a reach outside its box,
+		// fit all of those first so every pair is in the overlaps of both boxes
+		for (size_t i = 0; i < movingEntities.size(); i++) {
+			int box = m_boxIndices.get(movingEntities[i]->getId());
+			if (box >= 0 && !(glm::all(glm::greaterThanEqual(reachMins[i], m_boxes[box].min)) && glm::all(glm::lessThanEqual(reachMaxes[i], m_boxes[box].max)))) {
+				fitBox(box, reachMins[i], reachMaxes[i]);
+			}
+		}
+
+		size_t firstPair = outPairs.size();
+		for (size_t i = 0; i < movingEntities.size(); i++) {
+			int box = m_boxIndices.get(movingEntities[i]->getId());
+
+			if (box >= 0) {
+				for (int other : m_boxes[box].overlaps) {
+					testPair(movingEntities, reachMins, reachMaxes, (int)i, m_boxes[other].entity, outPairs);
+				}
+			}
+			else {
+				// Not collidable itself, so it has no box to keep overlaps for
+				for (auto& other : m_boxes) {
+					if (other.entity && aabbsOverlap(reachMins[i], reachMaxes[i], other.min, other.max)) {
+						testPair(movingEntities, reachMins, reachMaxes, (int)i, other.entity, outPairs);
+					}
+				}
+			}
+		}
+
+		// A pair of two moving entities in the structure can be found from both sides.
+		// Let the entity that comes first own those pairs and remove the duplicates
+		for (size_t i = firstPair; i < outPairs.size(); i++) {
+			EntityPair& pair = outPairs[i];
+			int index2 = getMovingEntityIndex(pair.entity2);
+			if (index2 >= 0 && index2 < getMovingEntityIndex(pair.entity1) && hasEntity(pair.entity1)) {
+				std::swap(pair.entity1, pair.entity2);
+			}
+		}
+
+		std::sort(outPairs.begin() + firstPair, outPairs.end(), [&](const EntityPair& pair1, const EntityPair& pair2) {
+			int index1 = getMovingEntityIndex(pair1.entity1);
+			int index2 = getMovingEntityIndex(pair2.entity1);
+			if (index1 != index2) {
+				return index1 < index2;
+			}
+			return pair1.entity2->getId() < pair2.entity2->getId();
+		});
+		auto endOfPairs = std::unique(outPairs.begin() + firstPair, outPairs.end(), [](const EntityPair& pair1, const EntityPair& pair2) {
+			return pair1.entity1 == pair2.entity1 && pair1.entity2 == pair2.entity2;
+		});
+		outPairs.erase(endOfPairs, outPairs.end());
+
+		clearMovingEntityIndices(movingEntities);
+	}
+
+	void SweepAndPrune::getEntitiesInAabb(const glm::vec3& min, const glm::vec3& max, std::vector<Entity*>& outEntities) {
+		for (auto& box : m_boxes) {
+			if (box.entity && aabbsOverlap(min, max, box.min, box.max)) {
+				outEntities.push_back(box.entity);
+			}
+		}
+	}
+
+	void SweepAndPrune::getRayIntersection(const glm::vec3& rayStart, const glm::vec3& rayDir, RayIntersectionInfo* outIntersectionData, Entity* ignoreThis, const bool doSimpleIntersections, const bool /*checkBackfaces*/) {
+		Ray ray(rayStart, rayDir);
+		const glm::vec3& normalizedRayDir = ray.getNormals()[0];
+
+		for (auto& box : m_boxes) {
+			if (!box.entity) {
+				continue;
+			}
+
+			float distance = Intersection::continousAABB(rayStart, rayStart, box.min, box.max, normalizedRayDir, glm::vec3(0.f), INFINITY);
+			if (distance < 0.0f || (outIntersectionData->closestHit >= 0.0f && distance > outIntersectionData->closestHit)) {
+				continue;
+			}
+
+			intersectRayWithEntity(&ray, box.entity, outIntersectionData, ignoreThis, doSimpleIntersections);
+		}
+	}
+
+}
\ No newline at end of file
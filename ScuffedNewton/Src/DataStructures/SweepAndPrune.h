@@ -0,0 +1,81 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "Broadphase.h"
+
+namespace Scuffed {
+
+	class Entity;
+
+	// Sort and sweep over the x, y and z axes. The box end points stay sorted between updates and are re-sorted with insertion sort,
+	// which is close to linear when things move a little each update. Swaps of end points add and remove overlapping pairs,
+	// so every box keeps a list of the boxes it overlaps and a query only has to test those
+	class SweepAndPrune : public Broadphase {
+	private:
+		struct Endpoint {
+			float value;
+			int box; // -1 once the box is removed, the end point is then skipped until the next update takes it out
+			bool isMin;
+		};
+
+		struct SapBox {
+			Entity* entity = nullptr;
+			glm::vec3 min = glm::vec3(0.f); // Enlarged by the margin and the reach of the entity
+			glm::vec3 max = glm::vec3(0.f);
+			int minEndpoints[3] = { -1, -1, -1 }; // Index in m_endpoints for each axis
+			int maxEndpoints[3] = { -1, -1, -1 };
+			std::vector<int> overlaps; // Boxes overlapping this box
+		};
+
+		std::vector<Endpoint> m_endpoints[3];
+		std::vector<SapBox> m_boxes;
+		std::vector<int> m_freeBoxes;
+		IdMap m_boxIndices; // Entity id -> index in m_boxes, -1 if the entity is not in the structure
+
+		bool m_hasDeadEndpoints; // Removed boxes have left end points behind
+
+		float m_fatMargin; // How much the boxes are enlarged in every direction
+		float m_sweepTime; // dt of the last update. The boxes cover the reach of the entities during this time
+
+		// The same reach as the collision system finds for the entity
+		void getReachBox(Entity* entity, glm::vec3& outMin, glm::vec3& outMax);
+		// Sets the box to the given area enlarged by the margin and sorts its end points into place
+		void fitBox(int box, const glm::vec3& min, const glm::vec3& max);
+		void removeDeadEndpoints();
+		bool boxesOverlap(int box1, int box2) const;
+		void addPair(int box1, int box2);
+		void removePair(int box1, int box2);
+
+		void swapEndpoints(int axis, int index1, int index2);
+		void setEndpointIndex(int axis, int index);
+		void sortMinDown(int axis, int index);
+		void sortMinUp(int axis, int index);
+		void sortMaxDown(int axis, int index);
+		void sortMaxUp(int axis, int index);
+
+	public:
+		SweepAndPrune();
+		virtual ~SweepAndPrune();
+
+		virtual void addEntity(Entity* newEntity);
+		virtual void removeEntity(Entity* entityToRemove);
+		virtual bool hasEntity(Entity* entity) const;
+
+		virtual void update(const float dt);
+
+		virtual void beginConcurrentQueries();
+
+		using Broadphase::getNextContinousCollision;
+		virtual void getNextContinousCollision(Entity* entity, Box* entityBoundingBox, const glm::vec3& entityVel, std::vector<CollisionInfo>& outCollisionInfo, float& collisionTime, std::vector<CollisionInfo>& zeroDistances, const float& dt = INFINITY, const bool doSimpleCollisions = false, const bool checkBackfaces = false);
+		virtual void getRayIntersection(const glm::vec3& rayStart, const glm::vec3& rayDir, RayIntersectionInfo* outIntersectionData, Entity* ignoreThis = nullptr, const bool doSimpleIntersections = false, const bool checkBackfaces = false);
+
+		// Uses the overlapping boxes instead of searching. The boxes of moving entities whose reach isn't inside them are fitted to the reach first
+		virtual void getPairs(const std::vector<Entity*>& movingEntities, const std::vector<glm::vec3>& reachMins, const std::vector<glm::vec3>& reachMaxes, std::vector<EntityPair>& outPairs);
+
+	protected:
+		virtual void getEntitiesInAabb(const glm::vec3& min, const glm::vec3& max, std::vector<Entity*>& outEntities);
+	};
+
+}
\ No newline at end of file
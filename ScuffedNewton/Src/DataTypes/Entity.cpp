@@ -10,12 +10,11 @@ namespace Scuffed {
 	Entity::Entity(Scene* scene) {
 		m_id = Utils::instance()->GetEntityIdCounter(true);
 		m_scene = scene;
+		m_registry = scene->getComponentRegistry();
 	}
 
 	Entity::~Entity() {
-		for (auto it : m_components) {
-			delete it.second;
-		}
+		m_registry->removeAllComponents(m_id);
 	}
 
 	unsigned int Entity::getId() const {
@@ -73,21 +72,20 @@ namespace Scuffed {
 		return false;
 	}
 
-	bool Entity::hasComponents(const std::unordered_map<std::string, bool>& requiredComponents) {
-		for (auto it = requiredComponents.begin(); it != requiredComponents.end(); it++) {
-			if (m_components.count(it->first) <= 0) {
-				return false;
-			}
-		}
-		return true;
+	bool Entity::hasComponents(const ComponentMask& requiredComponents) const {
+		return (m_componentMask & requiredComponents) == requiredComponents;
 	}
 
-	void Entity::addToSystems() {
-		m_scene->addEntityToSystems(this);
+	const ComponentMask& Entity::getComponentMask() const {
+		return m_componentMask;
 	}
 
-	void Entity::removeFromSystems() {
-		m_scene->removeEntityFromSystems(this);
+	void Entity::addToSystems(int componentType) {
+		m_scene->addEntityToSystems(this, componentType);
+	}
+
+	void Entity::removeFromSystems(int componentType) {
+		m_scene->removeEntityFromSystems(this, componentType);
 	}
 
 }
\ No newline at end of file
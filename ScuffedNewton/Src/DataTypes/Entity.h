@@ -4,6 +4,7 @@
 #include <string>
 
 #include "../Utils/Utils.h"
+#include "../DataStructures/ComponentRegistry.h"
 
 namespace Scuffed {
 
@@ -20,7 +21,8 @@ namespace Scuffed {
 		virtual void removeComponent(int componentNumber);
 		virtual Component* getComponent(int componentNumber);
 		virtual bool hasComponent(int componentNumber);
-		virtual bool hasComponents(const std::unordered_map<std::string, bool>& requiredComponents);
+		virtual bool hasComponents(const ComponentMask& requiredComponents) const;
+		virtual const ComponentMask& getComponentMask() const;
 
 	public:
 		// ----Template functions----
@@ -39,58 +41,59 @@ namespace Scuffed {
 		// --------------------------
 
 	private:
-		void addToSystems();
-		void removeFromSystems();
+		void addToSystems(int componentType);
+		void removeFromSystems(int componentType);
 
 	private:
 		unsigned int m_id;
 
 		Scene* m_scene;
 
-		std::unordered_map<std::string, Component*> m_components;
+		ComponentRegistry* m_registry; // Components are stored in the scene's registry, indexed by entity id
+		ComponentMask m_componentMask; // Bit n is set if the entity has the component with TYPE n
 	};
 
 	// ----Template functions----
 	template<typename ComponentType, typename... Targs>
 	inline ComponentType* Entity::addComponent(Targs... args) {
-		if (m_components[ComponentType::ID]) {
+		ComponentPool<ComponentType>* pool = m_registry->getPool<ComponentType>();
+		if (pool->has(m_id)) {
 			//SAIL_LOG_WARNING("Tried to add a duplicate component to an entity");
 			std::cout << "Tried to add a duplicate component to an entity\n";
 		}
 		else {
-			m_components[ComponentType::ID] = SN_NEW ComponentType(args...);
+			pool->add(m_id, args...);
+			m_componentMask.set(ComponentType::TYPE);
 
 			// Place this entity within the correct systems if told to
 			//if (tryToAddToSystems) {
-			addToSystems();
+			addToSystems(ComponentType::TYPE);
 			//}
 		}
 
 		// Return pointer to the component
-		return static_cast<ComponentType*>(m_components[ComponentType::ID]);
+		return pool->get(m_id);
 	}
 
 	template<typename ComponentType>
 	inline void Entity::removeComponent() {
 		if (hasComponent<ComponentType>()) {
-			delete m_components[ComponentType::ID];
-
 			// Remove this entity from systems which required the removed component
-			removeFromSystems();
+			removeFromSystems(ComponentType::TYPE);
+
+			m_componentMask.reset(ComponentType::TYPE);
+			m_registry->getPool<ComponentType>()->remove(m_id);
 		}
 	}
 
 	template<typename ComponentType>
 	inline ComponentType* Entity::getComponent() {
-		if (hasComponent<ComponentType>()) {
-			return static_cast<ComponentType*>(m_components[ComponentType::ID]);
-		}
-		return nullptr;
+		return m_registry->getPool<ComponentType>()->get(m_id);
 	}
 
 	template<typename ComponentType>
 	inline bool Entity::hasComponent() const {
-		return m_components.find(ComponentType::ID) != m_components.end();
+		return m_componentMask.test(ComponentType::TYPE);
 	}
 	// --------------------------
 }
\ No newline at end of file
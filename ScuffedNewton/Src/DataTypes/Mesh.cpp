@@ -1,8 +1,15 @@
 #include "../pch.h"
 
+#include <algorithm>
+
 #include "Mesh.h"
 #include "../Shapes/Box.h"
 #include "../Calculations/Intersection.h"
+#include "../Utils/ThreadPool.h"
+#include "../Utils/MappedFile.h"
+
+#include <cstring>
+#include <fstream>
 
 namespace Scuffed {
 
@@ -15,32 +22,300 @@ namespace Scuffed {
 
 		m_indices = nullptr;
 		m_nrOfIndices = 0;
+		m_version = 0;
+
+		m_pendingMesh = nullptr;
+
+		m_triangles = nullptr;
+		m_nrOfTriangles = 0;
+		m_cacheFile = nullptr;
+		m_bvhNodeData = nullptr;
+		m_nrOfBvhNodes = 0;
+		m_bvhTriangleData = nullptr;
 
 		m_softLimitTriangles = 10;
 		m_minimumNodeHalfSize = 1.0f;
+
+		m_structure = MeshStructures::Octree;
 	}
 
 	Mesh::~Mesh() {
+		if (m_pendingMesh) {
+			m_pendingBuild.wait();
+			delete m_pendingMesh;
+		}
+
 		clean(&m_baseNode);
+		delete m_cacheFile;
 	}
 
 	void Mesh::loadData(void* data, size_t size, size_t vertexSize, size_t positionOffset, size_t positionSize) {
+		load(data, size, vertexSize, positionOffset, positionSize, m_indices, m_nrOfIndices);
+	}
+
+	void Mesh::loadIndices(int* indices, int nrOfIndices) {
+		m_indices = indices;
+		m_nrOfIndices = nrOfIndices;
+
+		updateData();
+	}
+
+	void Mesh::load(void* data, size_t size, size_t vertexSize, size_t positionOffset, size_t positionSize, int* indices, int nrOfIndices, ThreadPool* threadPool) {
 		m_data = data;
 		m_size = size;
 		m_vertexSize = vertexSize;
 		m_positionOffset = positionOffset;
 		m_positionSize = positionSize;
 
+		m_indices = indices;
+		m_nrOfIndices = indices ? nrOfIndices : 0;
+
+		updateData(threadPool);
+	}
+
+	void Mesh::loadAsync(void* data, size_t size, size_t vertexSize, size_t positionOffset, size_t positionSize, int* indices, int nrOfIndices, int nrOfThreads) {
+		// Only the latest data is used, an earlier build still running is thrown away
+		if (m_pendingMesh) {
+			m_pendingBuild.wait();
+			delete m_pendingMesh;
+		}
+
+		Mesh* pendingMesh = SN_NEW Mesh();
+		pendingMesh->m_structure = m_structure;
+		m_pendingMesh = pendingMesh;
+
+		m_pendingBuild = std::async(std::launch::async, [=] {
+			// The build thread uses a pool of its own, the scene's pool can only be used by the thread updating the scene
+			ThreadPool threadPool(nrOfThreads);
+			pendingMesh->load(data, size, vertexSize, positionOffset, positionSize, indices, nrOfIndices, &threadPool);
+		});
+	}
+
+	bool Mesh::finishLoading() {
+		if (!m_pendingMesh) {
+			return true;
+		}
+
+		if (m_pendingBuild.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			return false;
+		}
+		m_pendingBuild.get();
+
+		m_data = m_pendingMesh->m_data;
+		m_size = m_pendingMesh->m_size;
+		m_vertexSize = m_pendingMesh->m_vertexSize;
+		m_positionOffset = m_pendingMesh->m_positionOffset;
+		m_positionSize = m_pendingMesh->m_positionSize;
+		m_indices = m_pendingMesh->m_indices;
+		m_nrOfIndices = m_pendingMesh->m_nrOfIndices;
+
+		m_triangleData.swap(m_pendingMesh->m_triangleData);
+		m_bvhNodes.swap(m_pendingMesh->m_bvhNodes);
+		m_bvhTriangles.swap(m_pendingMesh->m_bvhTriangles);
+
+		// The node boxes are taken over, the pending mesh must not delete them
 		clean(&m_baseNode);
-		setUpOctree();
+		m_baseNode = m_pendingMesh->m_baseNode;
+		m_pendingMesh->m_baseNode = OctNode();
+		m_minimumNodeHalfSize = m_pendingMesh->m_minimumNodeHalfSize;
+
+		useBuiltData();
+		m_version++;
+
+		delete m_pendingMesh;
+		m_pendingMesh = nullptr;
+
+		return true;
 	}
 
-	void Mesh::loadIndices(int* indices, int nrOfIndices) {
-		m_indices = indices;
-		m_nrOfIndices = nrOfIndices;
+	void Mesh::setStructure(MeshStructures::types type) {
+		if (type != m_structure) {
+			m_structure = type;
+			updateData();
+		}
+	}
+
+	void Mesh::updateData(ThreadPool* threadPool) {
+		m_version++;
+		setUpTriangleData(threadPool);
 
 		clean(&m_baseNode);
-		setUpOctree();
+		m_bvhNodes.clear();
+		m_bvhTriangles.clear();
+		useBuiltData();
+
+		if (m_structure == MeshStructures::Bvh) {
+			setUpBvh(threadPool);
+			useBuiltData();
+		}
+		else {
+			setUpOctree();
+		}
+	}
+
+	void Mesh::useBuiltData() {
+		if (m_cacheFile) {
+			delete m_cacheFile;
+			m_cacheFile = nullptr;
+		}
+
+		m_triangles = m_triangleData.data();
+		m_nrOfTriangles = (int)m_triangleData.size();
+		m_bvhNodeData = m_bvhNodes.data();
+		m_nrOfBvhNodes = (int)m_bvhNodes.size();
+		m_bvhTriangleData = m_bvhTriangles.data();
+	}
+
+	unsigned long long Mesh::getSourceHash() {
+		// 64 bit FNV-1a, taking 8 bytes at a time since it has to get through the whole mesh every time the cache is loaded
+		unsigned long long hash = 14695981039346656037ull;
+		auto add = [&hash](const void* data, size_t size) {
+			const unsigned char* bytes = static_cast<const unsigned char*>(data);
+			size_t i = 0;
+			for (; i + 8 <= size; i += 8) {
+				unsigned long long word;
+				std::memcpy(&word, bytes + i, 8);
+				hash = (hash ^ word) * 1099511628211ull;
+			}
+			for (; i < size; i++) {
+				hash = (hash ^ bytes[i]) * 1099511628211ull;
+			}
+		};
+
+		unsigned long long layout[5] = { m_size, m_vertexSize, m_positionOffset, m_positionSize, (unsigned long long)m_nrOfIndices };
+		add(layout, sizeof(layout));
+		if (m_data) {
+			add(m_data, m_size);
+		}
+		if (m_indices) {
+			add(m_indices, m_nrOfIndices * sizeof(int));
+		}
+
+		return hash;
+	}
+
+	bool Mesh::loadCached(void* data, size_t size, size_t vertexSize, size_t positionOffset, size_t positionSize, int* indices, int nrOfIndices, const std::string& cachePath, ThreadPool* threadPool) {
+		m_data = data;
+		m_size = size;
+		m_vertexSize = vertexSize;
+		m_positionOffset = positionOffset;
+		m_positionSize = positionSize;
+
+		m_indices = indices;
+		m_nrOfIndices = indices ? nrOfIndices : 0;
+		m_structure = MeshStructures::Bvh;
+
+		MappedFile* file = SN_NEW MappedFile();
+		if (file->open(cachePath) && file->getSize() >= sizeof(CacheHeader)) {
+			const char* fileData = static_cast<const char*>(file->getData());
+			const CacheHeader* header = reinterpret_cast<const CacheHeader*>(fileData);
+			const unsigned long long fileSize = file->getSize();
+			const unsigned int nrOfTriangles = (unsigned int)((m_nrOfIndices > 0 ? m_nrOfIndices : getNumberOfVertices()) / 3);
+
+			bool valid = std::memcmp(header->magic, "SNMC", 4) == 0 && header->version == CACHE_VERSION &&
+				header->triangleDataSize == sizeof(TriangleData) && header->bvhNodeSize == sizeof(BvhNode) &&
+				header->nrOfTriangles == nrOfTriangles &&
+				header->triangleDataOffset % 16 == 0 && header->bvhNodesOffset % 16 == 0 && header->bvhTrianglesOffset % 16 == 0 &&
+				header->triangleDataOffset + header->nrOfTriangles * sizeof(TriangleData) <= fileSize &&
+				header->bvhNodesOffset + header->nrOfBvhNodes * sizeof(BvhNode) <= fileSize &&
+				header->bvhTrianglesOffset + header->nrOfTriangles * sizeof(int) <= fileSize &&
+				header->sourceHash == getSourceHash(); // Last, it reads all of the data
+
+			if (valid) {
+				// Nothing is built, the queries read straight from the file
+				m_version++;
+				clean(&m_baseNode);
+				std::vector<TriangleData>().swap(m_triangleData);
+				std::vector<BvhNode>().swap(m_bvhNodes);
+				std::vector<int>().swap(m_bvhTriangles);
+				useBuiltData();
+
+				m_triangles = reinterpret_cast<const TriangleData*>(fileData + header->triangleDataOffset);
+				m_nrOfTriangles = (int)header->nrOfTriangles;
+				m_bvhNodeData = reinterpret_cast<const BvhNode*>(fileData + header->bvhNodesOffset);
+				m_nrOfBvhNodes = (int)header->nrOfBvhNodes;
+				m_bvhTriangleData = reinterpret_cast<const int*>(fileData + header->bvhTrianglesOffset);
+				m_cacheFile = file;
+
+				return true;
+			}
+		}
+
+		delete file;
+		updateData(threadPool);
+		return false;
+	}
+
+	bool Mesh::saveStructure(const std::string& cachePath) {
+		if (m_structure != MeshStructures::Bvh || isLoading()) {
+			return false;
+		}
+
+		// Every array starts at a multiple of 16 bytes, which is enough for all of them
+		auto align = [](unsigned long long offset) {
+			return (offset + 15) & ~15ull;
+		};
+
+		CacheHeader header;
+		std::memcpy(header.magic, "SNMC", 4);
+		header.version = CACHE_VERSION;
+		header.sourceHash = getSourceHash();
+		header.triangleDataSize = sizeof(TriangleData);
+		header.bvhNodeSize = sizeof(BvhNode);
+		header.nrOfTriangles = (unsigned int)m_nrOfTriangles;
+		header.nrOfBvhNodes = (unsigned int)m_nrOfBvhNodes;
+		header.triangleDataOffset = align(sizeof(CacheHeader));
+		header.bvhNodesOffset = align(header.triangleDataOffset + header.nrOfTriangles * sizeof(TriangleData));
+		header.bvhTrianglesOffset = align(header.bvhNodesOffset + header.nrOfBvhNodes * sizeof(BvhNode));
+
+		std::ofstream file(cachePath, std::ios::binary | std::ios::trunc);
+		if (!file) {
+			return false;
+		}
+
+		const char padding[16] = {};
+		unsigned long long written = 0;
+		auto write = [&](const void* data, unsigned long long size, unsigned long long offset) {
+			file.write(padding, (std::streamsize)(offset - written));
+			file.write(static_cast<const char*>(data), (std::streamsize)size);
+			written = offset + size;
+		};
+
+		write(&header, sizeof(header), 0);
+		write(m_triangles, header.nrOfTriangles * sizeof(TriangleData), header.triangleDataOffset);
+		write(m_bvhNodeData, header.nrOfBvhNodes * sizeof(BvhNode), header.bvhNodesOffset);
+		write(m_bvhTriangleData, header.nrOfTriangles * sizeof(int), header.bvhTrianglesOffset);
+
+		return (bool)file;
+	}
+
+	void Mesh::setUpTriangleData(ThreadPool* threadPool) {
+		int nrOfTriangles = (m_nrOfIndices > 0 ? m_nrOfIndices : getNumberOfVertices()) / 3;
+		m_triangleData.resize(nrOfTriangles);
+
+		auto setUpTriangles = [&](int first, int last) {
+			for (int i = first; i < last; i++) {
+				TriangleData& data = m_triangleData[i];
+				for (int j = 0; j < 3; j++) {
+					data.vertices[j] = getVertexPosition(m_nrOfIndices > 0 ? m_indices[i * 3 + j] : i * 3 + j);
+				}
+
+				data.edges[0] = glm::normalize(data.vertices[1] - data.vertices[0]);
+				data.edges[1] = glm::normalize(data.vertices[2] - data.vertices[0]);
+				data.edges[2] = glm::normalize(data.vertices[2] - data.vertices[1]);
+				data.normal = glm::normalize(glm::cross(data.edges[0], data.edges[1]));
+			}
+		};
+
+		if (threadPool && threadPool->getNrOfThreads() > 1) {
+			const int chunkSize = 4096;
+			threadPool->parallelFor((nrOfTriangles + chunkSize - 1) / chunkSize, [&](size_t i) {
+				setUpTriangles((int)i * chunkSize, glm::min((int)i * chunkSize + chunkSize, nrOfTriangles));
+			});
+		}
+		else {
+			setUpTriangles(0, nrOfTriangles);
+		}
 	}
 
 	glm::vec3 Mesh::getVertexPosition(int vertexIndex) {
@@ -83,11 +358,41 @@ namespace Scuffed {
 	}
 
 	void Mesh::getTrianglesForCollisionTesting(std::vector<int> &triangles, Shape* shape) {
+		if (m_nrOfTriangles == 0) {
+			// Nothing loaded yet
+			return;
+		}
+
+		if (m_structure == MeshStructures::Bvh) {
+			glm::vec3 min(INFINITY), max(-INFINITY);
+			for (const auto& vertex : shape->getVertices()) {
+				min = glm::min(min, vertex);
+				max = glm::max(max, vertex);
+			}
+			bvhTriangles(triangles, min, max, glm::vec3(0.f), 0.f);
+			return;
+		}
+
 		//triangles = m_baseNode.triangles;
 		collisionTrianglesRec(triangles, shape, &m_baseNode);
 	}
 
 	void Mesh::getTrianglesForContinousCollisionTesting(std::vector<int>& triangles, Shape* shape, glm::vec3& shapeVel, glm::vec3& meshVel, const float maxTime) {
+		if (m_nrOfTriangles == 0) {
+			// Nothing loaded yet
+			return;
+		}
+
+		if (m_structure == MeshStructures::Bvh) {
+			glm::vec3 min(INFINITY), max(-INFINITY);
+			for (const auto& vertex : shape->getVertices()) {
+				min = glm::min(min, vertex);
+				max = glm::max(max, vertex);
+			}
+			bvhTriangles(triangles, min, max, shapeVel - meshVel, maxTime);
+			return;
+		}
+
 		//triangles = m_baseNode.triangles;
 		continousCollisionTrianglesRec(triangles, shape, shapeVel, meshVel, &m_baseNode, maxTime);
 	}
@@ -140,6 +445,16 @@ namespace Scuffed {
 		m_minimumNodeHalfSize = m_baseNode.halfSize.x / 30.0f; 
 
 		addTrianglesToOctree(trianglesToAdd);
+
+		// Node boxes never change after this, updating them here keeps collision queries read only
+		updateNodeDataRec(&m_baseNode);
+	}
+
+	void Mesh::updateNodeDataRec(OctNode* node) {
+		node->nodeBB->updateCachedData();
+		for (size_t i = 0; i < node->childNodes.size(); i++) {
+			updateNodeDataRec(&node->childNodes[i]);
+		}
 	}
 
 	bool Mesh::addTriangleRec(int triangle, OctNode* currentNode) {
@@ -264,14 +579,9 @@ namespace Scuffed {
 
 		glm::vec3 testNodeHalfSize = testNode->halfSize;
 
+		const TriangleData& data = getTriangleData(triangle);
 		for (int i = 0; i < 3; i++) {
-			glm::vec3 distanceVec(0.f);
-			if (m_nrOfIndices > 0) { // Has indices
-				distanceVec = getVertexPosition(m_indices[triangle + i]) - testNode->nodeBB->getMiddle();
-			}
-			else {
-				distanceVec = getVertexPosition(triangle + i) - testNode->nodeBB->getMiddle();
-			}
+			glm::vec3 distanceVec = data.vertices[i] - testNode->nodeBB->getMiddle();
 
 			if (distanceVec.x < -testNodeHalfSize.x || distanceVec.x > testNodeHalfSize.x ||
 				distanceVec.y < -testNodeHalfSize.y || distanceVec.y > testNodeHalfSize.y ||
@@ -317,4 +627,291 @@ namespace Scuffed {
 		}
 	}
 
+	void Mesh::setUpBvh(ThreadPool* threadPool) {
+		int nrOfTriangles = (int)m_triangleData.size();
+		if (nrOfTriangles == 0) {
+			return;
+		}
+
+		BvhBuildData build;
+		build.centroids.resize(nrOfTriangles);
+		build.triangleMins.resize(nrOfTriangles);
+		build.triangleMaxes.resize(nrOfTriangles);
+		build.threadPool = (threadPool && threadPool->getNrOfThreads() > 1) ? threadPool : nullptr;
+		m_bvhTriangles.resize(nrOfTriangles);
+
+		for (int i = 0; i < nrOfTriangles; i++) {
+			const TriangleData& data = m_triangleData[i];
+			build.triangleMins[i] = glm::min(glm::min(data.vertices[0], data.vertices[1]), data.vertices[2]);
+			build.triangleMaxes[i] = glm::max(glm::max(data.vertices[0], data.vertices[1]), data.vertices[2]);
+			build.centroids[i] = (build.triangleMins[i] + build.triangleMaxes[i]) * 0.5f;
+			m_bvhTriangles[i] = i * 3;
+		}
+
+		// A binary tree with at least one triangle per leaf never has more nodes than this
+		m_bvhNodes.reserve(nrOfTriangles * 2);
+		buildBvhRec(0, nrOfTriangles, 0, m_bvhNodes, build);
+	}
+
+	void Mesh::getBvhBounds(int first, int count, const BvhBuildData& build, glm::vec3& outMin, glm::vec3& outMax, glm::vec3& outCentroidMin, glm::vec3& outCentroidMax) {
+		auto bounds = [&](int begin, int end, glm::vec3& min, glm::vec3& max, glm::vec3& centroidMin, glm::vec3& centroidMax) {
+			min = centroidMin = glm::vec3(INFINITY);
+			max = centroidMax = glm::vec3(-INFINITY);
+			for (int i = begin; i < end; i++) {
+				int triangle = m_bvhTriangles[i] / 3;
+				min = glm::min(min, build.triangleMins[triangle]);
+				max = glm::max(max, build.triangleMaxes[triangle]);
+				centroidMin = glm::min(centroidMin, build.centroids[triangle]);
+				centroidMax = glm::max(centroidMax, build.centroids[triangle]);
+			}
+		};
+
+		if (!build.threadPool || count < BVH_PARALLEL_TRIANGLES) {
+			bounds(first, first + count, outMin, outMax, outCentroidMin, outCentroidMax);
+			return;
+		}
+
+		// Min and max don't depend on the order, so combining the chunks gives the same result as a single thread
+		const int chunkSize = BVH_PARALLEL_TRIANGLES / 4;
+		const int nrOfChunks = (count + chunkSize - 1) / chunkSize;
+		std::vector<glm::vec3> chunkBounds(nrOfChunks * 4);
+		build.threadPool->parallelFor(nrOfChunks, [&](size_t i) {
+			int begin = first + (int)i * chunkSize;
+			bounds(begin, glm::min(begin + chunkSize, first + count), chunkBounds[i * 4], chunkBounds[i * 4 + 1], chunkBounds[i * 4 + 2], chunkBounds[i * 4 + 3]);
+		});
+
+		outMin = outCentroidMin = glm::vec3(INFINITY);
+		outMax = outCentroidMax = glm::vec3(-INFINITY);
+		for (int i = 0; i < nrOfChunks; i++) {
+			outMin = glm::min(outMin, chunkBounds[i * 4]);
+			outMax = glm::max(outMax, chunkBounds[i * 4 + 1]);
+			outCentroidMin = glm::min(outCentroidMin, chunkBounds[i * 4 + 2]);
+			outCentroidMax = glm::max(outCentroidMax, chunkBounds[i * 4 + 3]);
+		}
+	}
+
+	void Mesh::binBvhTriangles(int first, int count, const BvhBuildData& build, const glm::vec3& centroidMin, const glm::vec3& centroidMax, BvhBin outBins[3][BVH_BINS]) {
+		glm::vec3 binScale(0.f);
+		for (int axis = 0; axis < 3; axis++) {
+			float extent = centroidMax[axis] - centroidMin[axis];
+			if (extent > 0.f) {
+				binScale[axis] = BVH_BINS / extent;
+			}
+		}
+
+		auto binTriangles = [&](int begin, int end, BvhBin bins[3][BVH_BINS]) {
+			for (int axis = 0; axis < 3; axis++) {
+				for (int i = 0; i < BVH_BINS; i++) {
+					bins[axis][i].min = glm::vec3(INFINITY);
+					bins[axis][i].max = glm::vec3(-INFINITY);
+					bins[axis][i].nrOfTriangles = 0;
+				}
+			}
+
+			for (int i = begin; i < end; i++) {
+				int triangle = m_bvhTriangles[i] / 3;
+				for (int axis = 0; axis < 3; axis++) {
+					BvhBin& bin = bins[axis][glm::min((int)((build.centroids[triangle][axis] - centroidMin[axis]) * binScale[axis]), BVH_BINS - 1)];
+					bin.min = glm::min(bin.min, build.triangleMins[triangle]);
+					bin.max = glm::max(bin.max, build.triangleMaxes[triangle]);
+					bin.nrOfTriangles++;
+				}
+			}
+		};
+
+		if (!build.threadPool || count < BVH_PARALLEL_TRIANGLES) {
+			binTriangles(first, first + count, outBins);
+			return;
+		}
+
+		const int chunkSize = BVH_PARALLEL_TRIANGLES / 4;
+		const int nrOfChunks = (count + chunkSize - 1) / chunkSize;
+		std::vector<BvhBin> chunkBins(nrOfChunks * 3 * BVH_BINS);
+		build.threadPool->parallelFor(nrOfChunks, [&](size_t i) {
+			int begin = first + (int)i * chunkSize;
+			binTriangles(begin, glm::min(begin + chunkSize, first + count), reinterpret_cast<BvhBin(*)[BVH_BINS]>(&chunkBins[i * 3 * BVH_BINS]));
+		});
+
+		for (int axis = 0; axis < 3; axis++) {
+			for (int i = 0; i < BVH_BINS; i++) {
+				BvhBin& bin = outBins[axis][i];
+				bin.min = glm::vec3(INFINITY);
+				bin.max = glm::vec3(-INFINITY);
+				bin.nrOfTriangles = 0;
+				for (int j = 0; j < nrOfChunks; j++) {
+					const BvhBin& chunkBin = chunkBins[(j * 3 + axis) * BVH_BINS + i];
+					bin.min = glm::min(bin.min, chunkBin.min);
+					bin.max = glm::max(bin.max, chunkBin.max);
+					bin.nrOfTriangles += chunkBin.nrOfTriangles;
+				}
+			}
+		}
+	}
+
+	void Mesh::buildBvhRec(int first, int count, int depth, std::vector<BvhNode>& nodes, const BvhBuildData& build) {
+		int nodeIndex = (int)nodes.size();
+		nodes.emplace_back();
+
+		glm::vec3 min, max, centroidMin, centroidMax;
+		getBvhBounds(first, count, build, min, max, centroidMin, centroidMax);
+
+		nodes[nodeIndex].min = min;
+		nodes[nodeIndex].max = max;
+		nodes[nodeIndex].secondChild = -1;
+		nodes[nodeIndex].firstTriangle = first;
+		nodes[nodeIndex].nrOfTriangles = count;
+
+		if (count <= 1 || depth >= BVH_MAX_DEPTH - 1) {
+			return;
+		}
+
+		// Find the cheapest split by the surface area heuristic, binning the triangles by their centroids along each axis
+		BvhBin bins[3][BVH_BINS];
+		binBvhTriangles(first, count, build, centroidMin, centroidMax, bins);
+
+		int bestAxis = -1;
+		int bestBin = 0;
+		float bestCost = INFINITY;
+		for (int axis = 0; axis < 3; axis++) {
+			if (centroidMax[axis] - centroidMin[axis] <= 0.f) {
+				continue;
+			}
+
+			// Area and triangle count of everything to the right of each split
+			float rightAreas[BVH_BINS];
+			int rightCounts[BVH_BINS];
+			glm::vec3 rightMin(INFINITY), rightMax(-INFINITY);
+			int rightCount = 0;
+			for (int i = BVH_BINS - 1; i > 0; i--) {
+				rightMin = glm::min(rightMin, bins[axis][i].min);
+				rightMax = glm::max(rightMax, bins[axis][i].max);
+				rightCount += bins[axis][i].nrOfTriangles;
+				rightAreas[i] = rightCount > 0 ? surfaceArea(rightMin, rightMax) : 0.f;
+				rightCounts[i] = rightCount;
+			}
+
+			glm::vec3 leftMin(INFINITY), leftMax(-INFINITY);
+			int leftCount = 0;
+			for (int i = 1; i < BVH_BINS; i++) {
+				leftMin = glm::min(leftMin, bins[axis][i - 1].min);
+				leftMax = glm::max(leftMax, bins[axis][i - 1].max);
+				leftCount += bins[axis][i - 1].nrOfTriangles;
+				if (leftCount == 0 || rightCounts[i] == 0) {
+					continue;
+				}
+
+				float cost = surfaceArea(leftMin, leftMax) * leftCount + rightAreas[i] * rightCounts[i];
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestBin = i;
+				}
+			}
+		}
+
+		// Cost relative to testing every triangle in this node, with traversing a node costing as much as testing a triangle
+		float nodeArea = surfaceArea(min, max);
+		bool split = bestAxis >= 0 && (nodeArea <= 0.f || 1.f + bestCost / nodeArea < (float)count);
+		if (!split && count <= BVH_MAX_LEAF_TRIANGLES) {
+			return;
+		}
+
+		int middle;
+		if (bestAxis >= 0) {
+			// Same bin calculation as when binning
+			float binScale = BVH_BINS / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+			auto it = std::partition(m_bvhTriangles.begin() + first, m_bvhTriangles.begin() + first + count, [&](int triangle) {
+				int bin = glm::min((int)((build.centroids[triangle / 3][bestAxis] - centroidMin[bestAxis]) * binScale), BVH_BINS - 1);
+				return bin < bestBin;
+			});
+			middle = (int)(it - m_bvhTriangles.begin());
+		}
+		else {
+			// All centroids are in the same place, just split the triangles in half
+			middle = first + count / 2;
+		}
+
+		nodes[nodeIndex].nrOfTriangles = 0;
+
+		if (build.threadPool && count >= BVH_PARALLEL_TRIANGLES) {
+			// Build the second subtree on another thread and append it after the first one.
+			// The children work on separate ranges of m_bvhTriangles, so the tree is the same as when built by a single thread
+			std::vector<BvhNode> secondNodes;
+			ThreadPool::Counter counter(0);
+			build.threadPool->submit([&] {
+				buildBvhRec(middle, first + count - middle, depth + 1, secondNodes, build);
+			}, &counter);
+			buildBvhRec(first, middle - first, depth + 1, nodes, build);
+			build.threadPool->wait(&counter);
+
+			int offset = (int)nodes.size();
+			nodes[nodeIndex].secondChild = offset;
+			for (auto& node : secondNodes) {
+				if (node.secondChild >= 0) {
+					node.secondChild += offset;
+				}
+				nodes.push_back(node);
+			}
+		}
+		else {
+			buildBvhRec(first, middle - first, depth + 1, nodes, build);
+			nodes[nodeIndex].secondChild = (int)nodes.size();
+			buildBvhRec(middle, first + count - middle, depth + 1, nodes, build);
+		}
+	}
+
+	float Mesh::surfaceArea(const glm::vec3& min, const glm::vec3& max) {
+		glm::vec3 size = max - min;
+		return 2.f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	void Mesh::bvhTriangles(std::vector<int>& triangles, const glm::vec3& min, const glm::vec3& max, const glm::vec3& vel, const float maxTime) const {
+		if (m_nrOfBvhNodes == 0) {
+			return;
+		}
+
+		// The tree depth is limited, so the nodes left to visit always fit
+		int stack[BVH_MAX_DEPTH];
+		int stackSize = 0;
+		stack[stackSize++] = 0;
+
+		while (stackSize > 0) {
+			int nodeIndex = stack[--stackSize];
+			const BvhNode& node = m_bvhNodeData[nodeIndex];
+
+			// Time interval the moving box overlaps the node on every axis
+			float timeFirst = 0.f;
+			float timeLast = maxTime;
+			for (int i = 0; i < 3 && timeFirst <= timeLast; i++) {
+				if (vel[i] == 0.f) {
+					if (max[i] < node.min[i] || min[i] > node.max[i]) {
+						timeFirst = INFINITY;
+					}
+				}
+				else {
+					float enter = (node.min[i] - max[i]) / vel[i];
+					float exit = (node.max[i] - min[i]) / vel[i];
+					if (enter > exit) {
+						std::swap(enter, exit);
+					}
+					timeFirst = glm::max(timeFirst, enter);
+					timeLast = glm::min(timeLast, exit);
+				}
+			}
+
+			if (timeFirst > timeLast) {
+				continue;
+			}
+
+			if (node.secondChild < 0) {
+				triangles.insert(triangles.end(), m_bvhTriangleData + node.firstTriangle, m_bvhTriangleData + node.firstTriangle + node.nrOfTriangles);
+			}
+			else {
+				// First child is visited first
+				stack[stackSize++] = node.secondChild;
+				stack[stackSize++] = nodeIndex + 1;
+			}
+		}
+	}
+
 }
\ No newline at end of file
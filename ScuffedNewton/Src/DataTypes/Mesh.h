@@ -1,17 +1,46 @@
 #pragma once
 
 #include <glm/vec3.hpp>
+#include <future>
+#include <string>
+#include <vector>
 
 namespace Scuffed {
 	class Box;
+	class MappedFile;
+	class Shape;
+	class ThreadPool;
+
+	namespace MeshStructures {
+		enum types {
+			Octree,
+			Bvh
+		};
+	}
 
 	class Mesh {
 	public:
 		Mesh();
-		~Mesh();
+		virtual ~Mesh();
 
 		virtual void loadData(void* data, size_t size, size_t vertexSize, size_t positionOffset, size_t positionSize);
 		virtual void loadIndices(int* indices, int nrOfIndices);
+		// Loads both the vertex data and the indices (nullptr if there are none) and only builds the structures once.
+		// The build uses threadPool if one is given, it must be called from the thread using the pool
+		virtual void load(void* data, size_t size, size_t vertexSize, size_t positionOffset, size_t positionSize, int* indices, int nrOfIndices, ThreadPool* threadPool = nullptr);
+		// Same as load but builds on other threads. The data has to stay valid and unchanged until finishLoading returns true,
+		// and the mesh keeps using its current data until then
+		virtual void loadAsync(void* data, size_t size, size_t vertexSize, size_t positionOffset, size_t positionSize, int* indices, int nrOfIndices, int nrOfThreads);
+		// Starts using the data from loadAsync if it has been built. Returns false while it is still building. Can not be called during queries
+		virtual bool finishLoading();
+		bool isLoading() const { return m_pendingMesh != nullptr; }
+
+		// Same as load but uses the bounding volume hierarchy saved in cachePath by saveStructure if it was built from the same data.
+		// The file is mapped, not read, and has to stay unchanged while the mesh uses it. Returns false if the structure had to be built
+		virtual bool loadCached(void* data, size_t size, size_t vertexSize, size_t positionOffset, size_t positionSize, int* indices, int nrOfIndices, const std::string& cachePath, ThreadPool* threadPool = nullptr);
+		// Saves the bounding volume hierarchy and triangle data for loadCached. Only meshes using the Bvh structure can be saved.
+		// The file can only be loaded by a build with the same data layout as the one saving it
+		virtual bool saveStructure(const std::string& cachePath);
 
 		virtual glm::vec3 getVertexPosition(int vertexIndex);
 		virtual int getVertexIndex(int indexIndex);
@@ -19,7 +48,27 @@ namespace Scuffed {
 		virtual int getNumberOfVertices();
 		virtual int getNumberOfIndices();
 
+		// Structure used to find the triangles a shape can collide with. Octree (default) or Bvh, which is better for big meshes
+		virtual void setStructure(MeshStructures::types type);
+
+		// Recalculates everything built from the loaded data. Call after changing the vertices or indices the mesh was loaded with
+		virtual void updateData(ThreadPool* threadPool = nullptr);
+
+		// Positions, edges and normal of a triangle, calculated the same way as Triangle does
+		struct alignas(16) TriangleData {
+			glm::vec3 vertices[3];
+			glm::vec3 edges[3]; // Normalized v1 - v0, v2 - v0 and v2 - v1
+			glm::vec3 normal;
+		};
+
+		// triangle is the index of the triangle's first vertex (or index), as returned by the triangle queries
+		const TriangleData& getTriangleData(int triangle) const { return m_triangles[triangle / 3]; }
+		int getNumberOfTriangles() const { return m_nrOfTriangles; }
+		// Changes every time the data is updated, so anything holding triangle indices can tell if they are still valid
+		unsigned int getVersion() const { return m_version; }
+
 	private:
+		void setUpTriangleData(ThreadPool* threadPool);
 
 		void* m_data;
 		size_t m_size;
@@ -30,6 +79,24 @@ namespace Scuffed {
 		int* m_indices;
 		int m_nrOfIndices;
 
+		// Decoded once on load so the narrow phase doesn't have to read the interleaved vertex data
+		std::vector<TriangleData> m_triangleData;
+		unsigned int m_version;
+
+		// The data used by the queries, either the data built by the mesh or data in the mapped cache file
+		const TriangleData* m_triangles;
+		int m_nrOfTriangles;
+		MappedFile* m_cacheFile;
+
+		// Points the query data to the data built by the mesh and closes the cache file
+		void useBuiltData();
+		// Hash of the vertices, indices and layout the mesh is loaded with
+		unsigned long long getSourceHash();
+
+		// Mesh being built by loadAsync, its data is moved here by finishLoading
+		Mesh* m_pendingMesh;
+		std::future<void> m_pendingBuild;
+
 	public:
 		struct OctNode {
 			std::vector<OctNode> childNodes;
@@ -55,9 +122,70 @@ namespace Scuffed {
 		void expandBaseNode(glm::vec3 direction);
 		glm::vec3 findCornerOutside(int triangle, OctNode* testNode);
 		void clean(OctNode* node);
+		void updateNodeDataRec(OctNode* node);
 
 		void collisionTrianglesRec(std::vector<int> &triangles, Shape* shape, OctNode* node);
 		void continousCollisionTrianglesRec(std::vector<int>& triangles, Shape* shape, glm::vec3& shapeVel, glm::vec3& meshVel, OctNode* node, const float maxTime);
 		// ---------------------------
+
+		// ----Narrow phase bounding volume hierarchy----
+		// Nodes are stored depth first, so the first child of an inner node is the next node
+		struct BvhNode {
+			glm::vec3 min, max;
+			int secondChild; // -1 for leaves
+			int firstTriangle; // Index in m_bvhTriangles, leaves only
+			int nrOfTriangles;
+		};
+
+		static const int BVH_MAX_DEPTH = 64;
+		static const int BVH_MAX_LEAF_TRIANGLES = 4;
+		static const int BVH_BINS = 16;
+		static const int BVH_PARALLEL_TRIANGLES = 16384; // Nodes with fewer triangles are built by a single thread
+
+		// Data used while building, shared by all threads
+		struct BvhBuildData {
+			std::vector<glm::vec3> centroids;
+			std::vector<glm::vec3> triangleMins;
+			std::vector<glm::vec3> triangleMaxes;
+			ThreadPool* threadPool;
+		};
+
+		struct BvhBin {
+			glm::vec3 min, max;
+			int nrOfTriangles;
+		};
+
+		MeshStructures::types m_structure;
+		std::vector<BvhNode> m_bvhNodes;
+		std::vector<int> m_bvhTriangles; // Triangles in leaf order
+		const BvhNode* m_bvhNodeData; // Used by the queries, like m_triangles
+		int m_nrOfBvhNodes;
+		const int* m_bvhTriangleData;
+
+		// Start of a file saved by saveStructure, followed by the triangle data, nodes and triangle indices at the given offsets
+		struct CacheHeader {
+			char magic[4];
+			unsigned int version;
+			unsigned long long sourceHash;
+			unsigned int triangleDataSize; // Sizes of the structs, so files from a build with another layout are not used
+			unsigned int bvhNodeSize;
+			unsigned int nrOfTriangles;
+			unsigned int nrOfBvhNodes;
+			unsigned long long triangleDataOffset;
+			unsigned long long bvhNodesOffset;
+			unsigned long long bvhTrianglesOffset;
+		};
+		static const unsigned int CACHE_VERSION = 1;
+
+		void setUpBvh(ThreadPool* threadPool);
+		// Builds the subtree of the triangles in [first, first + count) of m_bvhTriangles, adding its nodes to nodes
+		void buildBvhRec(int first, int count, int depth, std::vector<BvhNode>& nodes, const BvhBuildData& build);
+		void getBvhBounds(int first, int count, const BvhBuildData& build, glm::vec3& outMin, glm::vec3& outMax, glm::vec3& outCentroidMin, glm::vec3& outCentroidMax);
+		void binBvhTriangles(int first, int count, const BvhBuildData& build, const glm::vec3& centroidMin, const glm::vec3& centroidMax, BvhBin outBins[3][BVH_BINS]);
+		static float surfaceArea(const glm::vec3& min, const glm::vec3& max);
+
+		// Adds the triangles of every leaf the box overlaps while moving with vel during maxTime
+		void bvhTriangles(std::vector<int>& triangles, const glm::vec3& min, const glm::vec3& max, const glm::vec3& vel, const float maxTime) const;
+		// ---------------------------
 	};
 }
\ No newline at end of file
@@ -5,12 +5,24 @@ namespace Scuffed {
 
 	Transform::Transform() {
 		m_matrix = glm::mat4(1.0f);
+		m_inverseMatrix = glm::mat4(1.0f);
+		m_matrixIsValid = false;
+		m_inverseMatrixNeedsUpdate = true;
 
 		m_translation = { 0.f, 0.f, 0.f };
 		m_rotation = glm::quat({ 0.f, 0.f, 0.f });
 		m_scale = { 1.f, 1.f, 1.f };
 		m_center = { 0.f, 0.f, 0.f };
 		m_hasChanged = 2;
+
+		m_isBound = false;
+		m_bound.matrix = glm::mat4(1.0f);
+		m_bound.position = m_translation;
+		m_writtenBoundPosition = m_translation;
+		m_writtenTranslation = m_translation;
+		m_writtenRotation = m_rotation;
+		m_writtenScale = m_scale;
+		saveStepStart();
 	}
 
 	Transform::~Transform() {
@@ -51,6 +63,15 @@ namespace Scuffed {
 		return m_matrix;
 	}
 
+	const glm::mat4& Transform::getInverseMatrixWithUpdate() {
+		updateInverseMatrix();
+		return m_inverseMatrix;
+	}
+
+	const glm::mat4& Transform::getInverseMatrixWithoutUpdate() const {
+		return m_inverseMatrix;
+	}
+
 	glm::vec3 Transform::getTranslation() const {
 		return m_translation;
 	}
@@ -65,24 +86,120 @@ namespace Scuffed {
 	}
 
 	void Transform::bindMatrixPointer(glm::mat4** matrix) {
-		*matrix = &m_matrix;
+		if (!m_isBound) {
+			m_isBound = true;
+			updateBoundData(1.f);
+		}
+		*matrix = &m_bound.matrix;
 	}
 
 	void Transform::bindPositionPointer(glm::vec3** position) {
-		*position = &m_translation;
+		if (!m_isBound) {
+			m_isBound = true;
+			updateBoundData(1.f);
+		}
+		*position = &m_bound.position;
+	}
+
+	bool Transform::isBound() const {
+		return m_isBound;
+	}
+
+	void Transform::saveStepStart() {
+		m_stepStartTranslation = m_translation;
+		m_stepStartRotation = m_rotation;
+		m_stepStartScale = m_scale;
+	}
+
+	void Transform::updateBoundData(float interpolation) {
+		if (interpolation >= 1.f || (m_stepStartTranslation == m_translation && m_stepStartRotation == m_rotation && m_stepStartScale == m_scale)) {
+			m_bound.matrix = getMatrixWithUpdate();
+			m_bound.position = m_translation;
+		}
+		else {
+			m_bound.position = glm::mix(m_stepStartTranslation, m_translation, interpolation);
+			m_bound.matrix = calculateMatrix(m_bound.position, glm::slerp(m_stepStartRotation, m_rotation, interpolation), glm::mix(m_stepStartScale, m_scale, interpolation), m_center);
+		}
+
+		m_writtenBoundPosition = m_bound.position;
+		m_writtenTranslation = m_translation;
+		m_writtenRotation = m_rotation;
+		m_writtenScale = m_scale;
+	}
+
+	void Transform::readBoundData() {
+		if (m_bound.position != m_writtenBoundPosition) {
+			setTranslation(m_bound.position);
+		}
+
+		if (m_translation != m_writtenTranslation || m_rotation != m_writtenRotation || m_scale != m_writtenScale) {
+			saveStepStart();
+		}
 	}
 
 	void Transform::updateMatrix() {
-		m_matrix = glm::mat4(1.0f);
+		if (m_matrixIsValid && m_translation == m_matrixTranslation && m_rotation == m_matrixRotation && m_scale == m_matrixScale && m_center == m_matrixCenter) {
+			return;
+		}
+
+		m_matrixIsValid = true;
+		m_inverseMatrixNeedsUpdate = true;
+		m_matrixTranslation = m_translation;
+		m_matrixRotation = m_rotation;
+		m_matrixScale = m_scale;
+		m_matrixCenter = m_center;
+
+		m_matrix = calculateMatrix(m_translation, m_rotation, m_scale, m_center);
+	}
+
+	glm::mat4 Transform::calculateMatrix(const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale, const glm::vec3& center) {
+		glm::mat4 matrix(1.0f);
 
-		m_matrix = glm::translate(m_matrix, m_translation);
-		if (glm::length2(m_rotation) > 0.001f) {
-			m_matrix = glm::translate(m_matrix, m_center);
-			m_matrix *= glm::toMat4(m_rotation);
-			//m_matrix = glm::rotate(m_matrix, 1.f, m_rotation);
-			m_matrix = glm::translate(m_matrix, -m_center);
+		matrix = glm::translate(matrix, translation);
+		if (glm::length2(rotation) > 0.001f) {
+			matrix = glm::translate(matrix, center);
+			matrix *= glm::toMat4(rotation);
+			//matrix = glm::rotate(matrix, 1.f, rotation);
+			matrix = glm::translate(matrix, -center);
 		}
-		m_matrix = glm::scale(m_matrix, m_scale);
+		matrix = glm::scale(matrix, scale);
+
+		return matrix;
+	}
+
+	void Transform::updateInverseMatrix() {
+		updateMatrix();
+		if (!m_inverseMatrixNeedsUpdate) {
+			return;
+		}
+		m_inverseMatrixNeedsUpdate = false;
+
+		// The upper 3x3 is a rotation times a scale, so its inverse is the transpose with each row divided by the squared scale.
+		// Falls back to a full inverse if the columns are not orthogonal (a rotation that is not normalized) or a scale is 0
+		glm::mat3 rotationScale(m_matrix);
+		const float tolerance = 1e-4f * glm::max(glm::max(glm::dot(rotationScale[0], rotationScale[0]), glm::dot(rotationScale[1], rotationScale[1])), glm::dot(rotationScale[2], rotationScale[2]));
+		if (glm::abs(glm::dot(rotationScale[0], rotationScale[1])) > tolerance || glm::abs(glm::dot(rotationScale[0], rotationScale[2])) > tolerance || glm::abs(glm::dot(rotationScale[1], rotationScale[2])) > tolerance) {
+			m_inverseMatrix = glm::inverse(m_matrix);
+			return;
+		}
+
+		glm::mat3 inverseRotationScale;
+		for (int i = 0; i < 3; i++) {
+			glm::vec3 column = rotationScale[i];
+			float length2 = glm::dot(column, column);
+			if (length2 == 0.f) {
+				m_inverseMatrix = glm::inverse(m_matrix);
+				return;
+			}
+
+			column /= length2;
+			inverseRotationScale[0][i] = column.x;
+			inverseRotationScale[1][i] = column.y;
+			inverseRotationScale[2][i] = column.z;
+		}
+
+		m_inverseMatrix = glm::mat4(inverseRotationScale);
+		m_inverseMatrix[3] = glm::vec4(-(inverseRotationScale * glm::vec3(m_matrix[3])), 1.0f);
 	}
 
 	const int Transform::getChange() {
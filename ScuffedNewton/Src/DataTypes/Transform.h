@@ -18,26 +18,70 @@ namespace Scuffed {
 
 		virtual glm::mat4 getMatrixWithUpdate();
 		virtual glm::mat4 getMatrixWithoutUpdate();
+		// Inverse of the matrix. Both are only recalculated when the translation, rotation, scale or center has changed
+		virtual const glm::mat4& getInverseMatrixWithUpdate();
+		virtual const glm::mat4& getInverseMatrixWithoutUpdate() const;
 
 		virtual glm::vec3 getTranslation() const;
 		virtual glm::vec3 getCenter() const;
 
 		virtual void prepareUpdate();
 
+		// The bound pointers point to copies only written by updateBoundData, so the client never sees a transform in the middle of an update
 		virtual void bindMatrixPointer(glm::mat4** matrix);
 		virtual void bindPositionPointer(glm::vec3** position);
+		virtual bool isBound() const;
+
+		// Saves the current translation, rotation and scale as the start of the next step, which updateBoundData interpolates from
+		virtual void saveStepStart();
+		// Writes the transform at interpolation between the step start (0) and the current state (1) to the bound copies
+		virtual void updateBoundData(float interpolation);
+		// Takes a position the client wrote through the bound pointer into use. Changes made since the last updateBoundData also become the step start, so they aren't interpolated
+		virtual void readBoundData();
 
 	private:
 		void updateMatrix();
+		void updateInverseMatrix();
+		static glm::mat4 calculateMatrix(const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale, const glm::vec3& center);
 
 	private:
 		glm::mat4 m_matrix;
+		glm::mat4 m_inverseMatrix;
 		glm::vec3 m_translation;
 		glm::quat m_rotation;
 		glm::vec3 m_scale;
 
 		glm::vec3 m_center;
 
+		// Values m_matrix was calculated from, changes are found by comparing
+		bool m_matrixIsValid;
+		bool m_inverseMatrixNeedsUpdate;
+		glm::vec3 m_matrixTranslation;
+		glm::quat m_matrixRotation;
+		glm::vec3 m_matrixScale;
+		glm::vec3 m_matrixCenter;
+
+		// What the bound pointers show. Copying a transform doesn't copy it, so the copies systems work on never write memory the client can be reading
+		struct BoundData {
+			BoundData() {}
+			BoundData(const BoundData&) {}
+			BoundData& operator=(const BoundData&) { return *this; }
+
+			glm::mat4 matrix;
+			glm::vec3 position;
+		};
+
+		// The bound data and the values it was last written with
+		bool m_isBound;
+		BoundData m_bound;
+		glm::vec3 m_writtenBoundPosition;
+		glm::vec3 m_writtenTranslation;
+		glm::quat m_writtenRotation;
+		glm::vec3 m_writtenScale;
+
+		glm::vec3 m_stepStartTranslation;
+		glm::quat m_stepStartRotation;
+		glm::vec3 m_stepStartScale;
 
 	private:
 		int m_hasChanged;
@@ -24,10 +24,46 @@ namespace Scuffed {
 		m_scene->update(dt);
 	}
 
+	void Interface::updateAsync(float dt) {
+		m_scene->updateAsync(dt);
+	}
+
+	bool Interface::isUpdateDone() {
+		return m_scene->isUpdateDone();
+	}
+
+	void Interface::waitForUpdate() {
+		m_scene->waitForUpdate();
+	}
+
+	void Interface::setFixedTimestep(float stepSize, int maxSteps) {
+		m_scene->setFixedTimestep(stepSize, maxSteps);
+	}
+
+	float Interface::getInterpolation() {
+		return m_scene->getInterpolation();
+	}
+
+	void Interface::setSleepThresholds(float speed, float time) {
+		m_scene->setSleepThresholds(speed, time);
+	}
+
+	void Interface::setNrOfThreads(int nrOfThreads) {
+		m_scene->setNrOfThreads(nrOfThreads);
+	}
+
+	void Interface::setBroadphase(Broadphases::types type) {
+		m_scene->setBroadphase(type);
+	}
+
 	int Interface::getNewEntityID() {
 		return m_scene->addEntity();
 	}
 
+	void Interface::removeEntity(int entityId) {
+		m_scene->removeEntity(entityId);
+	}
+
 	void Interface::loadMesh(int entityId, void* data, size_t size, size_t vertexSize, size_t positionOffset, size_t positionSize) {
 		//Find entity
 		Entity* e = m_scene->getEntity(entityId);
@@ -46,6 +82,83 @@ namespace Scuffed {
 		}
 	}
 
+	void Interface::loadMesh(int entityId, void* data, size_t size, size_t vertexSize, size_t positionOffset, size_t positionSize, int* indices, int nrOfIndices) {
+		//Find entity
+		Entity* e = m_scene->getEntity(entityId);
+		if (e) {
+			MeshComponent* comp = e->getComponent<MeshComponent>();
+			if (!comp) {
+				comp = e->addComponent<MeshComponent>();
+			}
+			comp->mesh->load(data, size, vertexSize, positionOffset, positionSize, indices, nrOfIndices, m_scene->getThreadPool());
+			comp->notifyChange();
+		}
+	}
+
+	void Interface::loadMeshAsync(int entityId, void* data, size_t size, size_t vertexSize, size_t positionOffset, size_t positionSize, int* indices, int nrOfIndices) {
+		//Find entity
+		Entity* e = m_scene->getEntity(entityId);
+		if (e) {
+			MeshComponent* comp = e->getComponent<MeshComponent>();
+			if (!comp) {
+				comp = e->addComponent<MeshComponent>();
+			}
+			comp->mesh->loadAsync(data, size, vertexSize, positionOffset, positionSize, indices, nrOfIndices, m_scene->getNrOfThreads());
+			m_scene->addLoadingMesh(entityId);
+		}
+	}
+
+	bool Interface::isMeshLoaded(int entityId) {
+		Entity* e = m_scene->getEntity(entityId);
+		MeshComponent* comp = e ? e->getComponent<MeshComponent>() : nullptr;
+		return !comp || !comp->mesh->isLoading();
+	}
+
+	bool Interface::loadMeshCached(int entityId, void* data, size_t size, size_t vertexSize, size_t positionOffset, size_t positionSize, int* indices, int nrOfIndices, const std::string& cachePath) {
+		//Find entity
+		Entity* e = m_scene->getEntity(entityId);
+		if (!e) {
+			return false;
+		}
+
+		MeshComponent* comp = e->getComponent<MeshComponent>();
+		if (!comp) {
+			comp = e->addComponent<MeshComponent>();
+		}
+		comp->notifyChange();
+
+		if (comp->mesh->loadCached(data, size, vertexSize, positionOffset, positionSize, indices, nrOfIndices, cachePath, m_scene->getThreadPool())) {
+			return true;
+		}
+
+		comp->mesh->saveStructure(cachePath);
+		return false;
+	}
+
+	void Interface::updateMesh(int entityId) {
+		//Find entity
+		Entity* e = m_scene->getEntity(entityId);
+		if (e) {
+			MeshComponent* comp = e->getComponent<MeshComponent>();
+			if (comp) {
+				comp->mesh->updateData();
+				comp->notifyChange();
+			}
+		}
+	}
+
+	void Interface::setMeshStructure(int entityId, MeshStructures::types type) {
+		//Find entity
+		Entity* e = m_scene->getEntity(entityId);
+		if (e) {
+			MeshComponent* comp = e->getComponent<MeshComponent>();
+			if (!comp) {
+				comp = e->addComponent<MeshComponent>();
+			}
+			comp->mesh->setStructure(type);
+		}
+	}
+
 	void Interface::bindModelMatrix(int entityId, glm::mat4** matrix) {
 		//Find entity
 		Entity* e = m_scene->getEntity(entityId);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "DataStructures/Scene.h"
+#include "DataTypes/Mesh.h"
 
 namespace Scuffed {
 
@@ -12,8 +13,42 @@ namespace Scuffed {
 		virtual void print();
 
 		virtual void update(float dt);
+		// Starts an update on another thread and returns immediately, so the bound matrices and positions can be read (e.g. for rendering) while it runs.
+		// Nothing else in the interface may be used until waitForUpdate, which publishes the new state to the bound pointers. update and the destructor wait as well
+		virtual void updateAsync(float dt);
+		virtual bool isUpdateDone();
+		virtual void waitForUpdate();
+		// Opt in to updating in fixed steps of stepSize, at most maxSteps per update call. dt is then added to an accumulator and the rest of a step is carried over to the next call.
+		// The bound matrices and positions are interpolated between the last two steps and only written after all steps are done. A stepSize of 0 (default) turns it off
+		virtual void setFixedTimestep(float stepSize, int maxSteps = 4);
+		// How far between the last two steps the bound matrices and positions are, 1 when not using a fixed timestep
+		virtual float getInterpolation();
+		// Touching moving entities that have all moved slower than speed for time seconds fall asleep and are skipped until they are moved, given a velocity or touched.
+		// A time of 0 (default) turns sleeping off
+		virtual void setSleepThresholds(float speed, float time);
+		// Threads used to update the scene, including the thread calling update. 1 (default) runs everything on the calling thread.
+		// With more than 1 thread the result does not depend on the number of threads
+		virtual void setNrOfThreads(int nrOfThreads);
+		// Structure used to find which entities can collide. Octree (default), AabbTree or SweepAndPrune
+		virtual void setBroadphase(Broadphases::types type);
 		virtual int getNewEntityID();
+		virtual void removeEntity(int entityId);
 		virtual void loadMesh(int entityId, void* data, size_t size, size_t vertexSize, size_t positionOffset, size_t positionSize);
+		// Loads the vertices and indices together so the mesh is only built once. indices can be nullptr
+		virtual void loadMesh(int entityId, void* data, size_t size, size_t vertexSize, size_t positionOffset, size_t positionSize, int* indices, int nrOfIndices);
+		// Builds the mesh on other threads, the entity keeps its current mesh until isMeshLoaded returns true.
+		// The data and indices have to stay valid and unchanged until then
+		virtual void loadMeshAsync(int entityId, void* data, size_t size, size_t vertexSize, size_t positionOffset, size_t positionSize, int* indices, int nrOfIndices);
+		// True when the entity has no mesh being built. A finished build is taken into use by update
+		virtual bool isMeshLoaded(int entityId);
+		// Loads the mesh with a bounding volume hierarchy read from cachePath if it was saved for the same data, otherwise builds it and saves it there.
+		// The file is mapped and must not be changed while the mesh is used. Returns true if the saved structure was used
+		virtual bool loadMeshCached(int entityId, void* data, size_t size, size_t vertexSize, size_t positionOffset, size_t positionSize, int* indices, int nrOfIndices, const std::string& cachePath);
+		// Call after changing the data given to loadMesh, the mesh keeps its own copy of the triangles
+		virtual void updateMesh(int entityId);
+		// Structure used to find the mesh triangles shapes can collide with. Octree (default) or Bvh, which builds and searches faster for big meshes
+		virtual void setMeshStructure(int entityId, MeshStructures::types type);
+		// The bound data is written at the end of update. A position written through the pointer is taken into use by the next update
 		virtual void bindModelMatrix(int entityId, glm::mat4** matrix);
 		virtual void bindPosition(int entityId, glm::vec3** positionVector);
 
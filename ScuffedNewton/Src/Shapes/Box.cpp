@@ -16,14 +16,14 @@ namespace Scuffed {
 	//	matrix					= otherBox.matrix;
 	//}
 
-	Box::Box(const glm::vec3& halfSize, const glm::vec3& origin) {
+	Box::Box(const glm::vec3& halfSize, const glm::vec3& origin) : Shape(ShapeTypes::Box) {
 		init();
 
 		m_originalMiddle = origin;
 		setHalfSize(halfSize);
 	}
 
-	Box::Box(glm::vec3 planes[6], const glm::vec3& origin) {
+	Box::Box(glm::vec3 planes[6], const glm::vec3& origin) : Shape(ShapeTypes::Box) {
 		init();
 
 		m_originalMiddle = origin;
@@ -39,12 +39,6 @@ namespace Scuffed {
 		matrix = glm::mat4(1.0f);
 		m_originalMiddle = { 0.f, 0.f, 0.f };
 
-		m_edges.resize(0);
-		m_originalPlanes.resize(6);
-		m_originalVertices.resize(8);
-		m_normals.resize(6);
-		m_vertices.resize(8);
-
 		m_hasChanged = false;
 	}
 
@@ -126,6 +120,32 @@ namespace Scuffed {
 		setUpdatesNeeded();
 	}
 
+	void Box::setData(const glm::vec3 vertices[8], const glm::vec3 normals[6]) {
+		baseMatrix = glm::mat4(1.0f);
+		matrix = glm::mat4(1.0f);
+
+		m_originalMiddle = glm::vec3(0.f);
+		for (int i = 0; i < 8; i++) {
+			m_originalVertices[i] = vertices[i];
+			m_vertices[i] = vertices[i];
+			m_originalMiddle += vertices[i] / 8.0f;
+		}
+		for (int i = 0; i < 8; i++) {
+			m_originalVertices[i] -= m_originalMiddle;
+		}
+		for (int i = 0; i < 6; i++) {
+			m_originalPlanes[i] = normals[i];
+			m_normals[i] = normals[i];
+		}
+		m_middle = m_originalMiddle;
+
+		// Everything is already in world space, nothing has to be recalculated until the box changes
+		m_normalsNeedsUpdate = false;
+		m_verticesNeedsUpdate = false;
+		m_middleNeedsUpdate = false;
+		m_hasChanged = true;
+	}
+
 	void Box::setBaseMatrix(const glm::mat4& newBaseMatrix) {
 		baseMatrix = newBaseMatrix;
 
@@ -138,34 +158,41 @@ namespace Scuffed {
 		setUpdatesNeeded();
 	}
 
-	std::vector<glm::vec3>& Box::getNormals() {
+	Vec3Span Box::getNormals() {
 		if (m_normalsNeedsUpdate) {
 			updateNormals();
 			m_normalsNeedsUpdate = false;
 		}
-		return m_normals;
+		return Vec3Span(m_normals.data(), m_normals.size());
 	}
 
-	std::vector<glm::vec3>& Box::getEdges() {
+	Vec3Span Box::getEdges() {
 		return getNormals(); 
 		//return m_edges;
 	}
 
-	std::vector<glm::vec3>& Box::getVertices() {
+	Vec3Span Box::getVertices() {
 		if (m_verticesNeedsUpdate) {
 			updateVertices();
 			m_verticesNeedsUpdate = false;
 		}
-		return m_vertices;
+		return Vec3Span(m_vertices.data(), m_vertices.size());
 	}
 
 	glm::vec3& Box::getMiddle() {
 		if (m_middleNeedsUpdate) {
 			m_middle = glm::vec3(matrix * baseMatrix * glm::vec4(m_originalMiddle, 1.0f));
+			m_middleNeedsUpdate = false;
 		}
 		return m_middle;
 	}
 
+	void Box::updateCachedData() {
+		getNormals();
+		getVertices();
+		getMiddle();
+	}
+
 	const bool Box::getChange() {
 		bool theChange = m_hasChanged;
 		m_hasChanged = false;
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+
 #include "Shape.h"
 
 namespace Scuffed {
@@ -16,14 +18,19 @@ namespace Scuffed {
 		virtual void setTranslation(const glm::vec3& translation);
 		virtual void translate(const glm::vec3& translation);
 		virtual void setPlanesFromOrigin(glm::vec3 planes[6]);
+		// Sets the box to the given world space corners and face normals, in the order getVertices and getNormals return them. Resets the matrices
+		virtual void setData(const glm::vec3 vertices[8], const glm::vec3 normals[6]);
 
 		virtual void setBaseMatrix(const glm::mat4& newBaseMatrix);
 		virtual void setMatrix(const glm::mat4& newMatrix);
-		virtual std::vector<glm::vec3>& getNormals();
-		virtual std::vector<glm::vec3>& getEdges();
-		virtual std::vector<glm::vec3>& getVertices();
+		virtual Vec3Span getNormals();
+		virtual Vec3Span getEdges();
+		virtual Vec3Span getVertices();
 		virtual glm::vec3& getMiddle();
 
+		// Updates everything that is otherwise lazily updated by the getters above. The getters only read after this until the box changes again
+		virtual void updateCachedData();
+
 	private:
 		void init();
 		void updateVertices();
@@ -31,16 +38,14 @@ namespace Scuffed {
 		void setUpdatesNeeded();
 
 	private:
-		std::vector<glm::vec3> m_originalVertices; // Not effected by matrices
-		std::vector<glm::vec3> m_originalPlanes; // Not effected by matrices
+		std::array<glm::vec3, 8> m_originalVertices; // Not effected by matrices
+		std::array<glm::vec3, 6> m_originalPlanes; // Not effected by matrices
 		glm::vec3 m_originalMiddle; // Not effected by matrices
 
-		std::vector<glm::vec3> m_vertices;
-		std::vector<glm::vec3> m_normals;
+		std::array<glm::vec3, 8> m_vertices;
+		std::array<glm::vec3, 6> m_normals;
 		glm::vec3 m_middle;
 
-		std::vector<glm::vec3> m_edges;
-		
 
 		bool m_normalsNeedsUpdate;
 		bool m_verticesNeedsUpdate;
@@ -48,8 +53,8 @@ namespace Scuffed {
 
 	private:
 		bool m_hasChanged;
-		friend class Octree;
-		const bool getChange(); //Only access this from Octree::updateRec
+		friend class Broadphase;
+		const bool getChange(); //Only access this from Broadphase::hasChanged
 	};
 
 }
\ No newline at end of file
@@ -2,11 +2,7 @@
 
 namespace Scuffed {
 
-	Ray::Ray(const glm::vec3& start, const glm::vec3& direction) {
-		m_vertices.resize(1);
-		m_normals.resize(1);
-		m_edges.resize(0);
-
+	Ray::Ray(const glm::vec3& start, const glm::vec3& direction) : Shape(ShapeTypes::Ray) {
 		m_vertices[0] = start;
 		m_normals[0] = glm::normalize(direction);
 		
@@ -38,16 +34,16 @@ namespace Scuffed {
 		m_vertices[0] = glm::vec3(matrix * glm::vec4(m_vertices[0], 1.0f));
 	}
 
-	std::vector<glm::vec3>& Ray::getNormals() {
-		return m_normals;
+	Vec3Span Ray::getNormals() {
+		return Vec3Span(m_normals.data(), m_normals.size());
 	}
 
-	std::vector<glm::vec3>& Ray::getEdges() {
-		return m_edges;
+	Vec3Span Ray::getEdges() {
+		return Vec3Span(nullptr, 0); // A ray has no edges
 	}
 
-	std::vector<glm::vec3>& Ray::getVertices() {
-		return m_vertices;
+	Vec3Span Ray::getVertices() {
+		return Vec3Span(m_vertices.data(), m_vertices.size());
 	}
 
 	glm::vec3& Ray::getMiddle() {
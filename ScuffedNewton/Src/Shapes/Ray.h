@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+
 #include "Shape.h"
 
 namespace Scuffed {
@@ -11,15 +13,14 @@ namespace Scuffed {
 
 		virtual void setBaseMatrix(const glm::mat4& newBaseMatrix);
 		virtual void setMatrix(const glm::mat4& newMatrix);
-		virtual std::vector<glm::vec3>& getNormals();
-		virtual std::vector<glm::vec3>& getEdges();
-		virtual std::vector<glm::vec3>& getVertices();
+		virtual Vec3Span getNormals();
+		virtual Vec3Span getEdges();
+		virtual Vec3Span getVertices();
 		virtual glm::vec3& getMiddle();
 
 	private:
-		std::vector<glm::vec3> m_vertices;
-		std::vector<glm::vec3> m_normals;
-		std::vector<glm::vec3> m_edges;
+		std::array<glm::vec3, 1> m_vertices;
+		std::array<glm::vec3, 1> m_normals;
 	};
 
 }
\ No newline at end of file
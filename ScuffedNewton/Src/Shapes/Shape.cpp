@@ -2,7 +2,8 @@
 
 namespace Scuffed {
 
-	Shape::Shape() {
+	Shape::Shape(ShapeTypes::types type) {
+		m_type = type;
 		matrix = glm::mat4(1.0f);
 		baseMatrix = glm::mat4(1.0f);
 	}
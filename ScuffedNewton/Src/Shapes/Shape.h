@@ -5,21 +5,49 @@
 
 namespace Scuffed {
 
+	namespace ShapeTypes {
+		enum types {
+			Box,
+			Triangle,
+			Ray
+		};
+	}
+
+	// View of the vectors a shape stores inline. Only valid as long as the shape is
+	class Vec3Span {
+	public:
+		Vec3Span(glm::vec3* data, size_t size) : m_data(data), m_size(size) {}
+
+		glm::vec3* begin() const { return m_data; }
+		glm::vec3* end() const { return m_data + m_size; }
+		size_t size() const { return m_size; }
+		glm::vec3& operator[](size_t index) const { return m_data[index]; }
+
+	private:
+		glm::vec3* m_data;
+		size_t m_size;
+	};
+
 	class Shape {
 	public:
-		Shape();
+		Shape(ShapeTypes::types type);
 		virtual ~Shape();
 
+		ShapeTypes::types getType() const { return m_type; }
+
 		virtual void setBaseMatrix(const glm::mat4& newBaseMatrix) = 0;
 		virtual void setMatrix(const glm::mat4& newMatrix) = 0;
-		virtual std::vector<glm::vec3>& getNormals() = 0;
-		virtual std::vector<glm::vec3>& getEdges() = 0;
-		virtual std::vector<glm::vec3>& getVertices() = 0;
+		virtual Vec3Span getNormals() = 0;
+		virtual Vec3Span getEdges() = 0;
+		virtual Vec3Span getVertices() = 0;
 		virtual glm::vec3& getMiddle() = 0;
 
 	protected:
 		glm::mat4 baseMatrix;
 		glm::mat4 matrix;
+
+	private:
+		ShapeTypes::types m_type;
 	};
 
 }
\ No newline at end of file
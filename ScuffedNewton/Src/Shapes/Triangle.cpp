@@ -2,7 +2,7 @@
 
 namespace Scuffed {
 
-	Triangle::Triangle(const glm::vec3& v1, const glm::vec3& v2, const glm::vec3& v3) {
+	Triangle::Triangle(const glm::vec3& v1, const glm::vec3& v2, const glm::vec3& v3) : Shape(ShapeTypes::Triangle) {
 		init();
 
 		setData(v1, v2, v3);
@@ -13,17 +13,14 @@ namespace Scuffed {
 	}
 
 	void Triangle::init() {
-		m_originalVertices.resize(3);
-		m_vertices.resize(3);
-		m_normals.resize(1);
-		m_edges.resize(3);
-
 		m_matricesHasChanged = false;
 	}
 
 	void Triangle::updateEdges() {
 		getVertices();
-		m_edges = { glm::normalize(m_vertices[1] - m_vertices[0]), glm::normalize(m_vertices[2] - m_vertices[0]), glm::normalize(m_vertices[2] - m_vertices[1]) };
+		m_edges[0] = glm::normalize(m_vertices[1] - m_vertices[0]);
+		m_edges[1] = glm::normalize(m_vertices[2] - m_vertices[0]);
+		m_edges[2] = glm::normalize(m_vertices[2] - m_vertices[1]);
 	}
 
 	void Triangle::updateNormals() {
@@ -58,6 +55,24 @@ namespace Scuffed {
 		m_verticesNeedsUpdate = true;
 	}
 
+	void Triangle::setData(const glm::vec3 vertices[3], const glm::vec3 edges[3], const glm::vec3& normal) {
+		baseMatrix = glm::mat4(1.0f);
+		matrix = glm::mat4(1.0f);
+		m_matricesHasChanged = false;
+
+		for (int i = 0; i < 3; i++) {
+			m_originalVertices[i] = vertices[i];
+			m_vertices[i] = vertices[i];
+			m_edges[i] = edges[i];
+		}
+		m_normals[0] = normal;
+
+		m_normalsNeedsUpdate = false;
+		m_edgesNeedsUpdate = false;
+		m_middleNeedsUpdate = true;
+		m_verticesNeedsUpdate = false;
+	}
+
 	void Triangle::setBaseMatrix(const glm::mat4& newBaseMatrix) {
 		baseMatrix = newBaseMatrix;
 
@@ -78,30 +93,30 @@ namespace Scuffed {
 		m_matricesHasChanged = true;
 	}
 
-	std::vector<glm::vec3>& Triangle::getNormals() {
+	Vec3Span Triangle::getNormals() {
 		if (m_normalsNeedsUpdate) {
 			updateNormals();
 			m_normalsNeedsUpdate = false;
 		}
 
-		return m_normals;
+		return Vec3Span(m_normals.data(), m_normals.size());
 	}
 
-	std::vector<glm::vec3>& Triangle::getEdges() {
+	Vec3Span Triangle::getEdges() {
 		if (m_edgesNeedsUpdate) {
 			updateEdges();
 			m_edgesNeedsUpdate = false;
 		}
 
-		return m_edges;
+		return Vec3Span(m_edges.data(), m_edges.size());
 	}
 
-	std::vector<glm::vec3>& Triangle::getVertices() {
+	Vec3Span Triangle::getVertices() {
 		if (m_verticesNeedsUpdate) {
 			updateVertices();
 			m_verticesNeedsUpdate = false;
 		}
-		return m_vertices;
+		return Vec3Span(m_vertices.data(), m_vertices.size());
 	}
 
 	glm::vec3& Triangle::getMiddle() {
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+
 #include "Shape.h"
 
 namespace Scuffed {
@@ -10,12 +12,14 @@ namespace Scuffed {
 		virtual ~Triangle();
 
 		virtual void setData(const glm::vec3& v1, const glm::vec3& v2, const glm::vec3& v3);
+		// Sets already calculated data, as if set with the vertices and no matrices
+		virtual void setData(const glm::vec3 vertices[3], const glm::vec3 edges[3], const glm::vec3& normal);
 
 		virtual void setBaseMatrix(const glm::mat4& newBaseMatrix);
 		virtual void setMatrix(const glm::mat4& newMatrix);
-		virtual std::vector<glm::vec3>& getNormals();
-		virtual std::vector<glm::vec3>& getEdges();
-		virtual std::vector<glm::vec3>& getVertices();
+		virtual Vec3Span getNormals();
+		virtual Vec3Span getEdges();
+		virtual Vec3Span getVertices();
 		virtual glm::vec3& getMiddle();
 
 	private:
@@ -27,10 +31,10 @@ namespace Scuffed {
 		void updateVertices();
 
 	private:
-		std::vector<glm::vec3> m_originalVertices;
-		std::vector<glm::vec3> m_vertices;
-		std::vector<glm::vec3> m_edges;
-		std::vector<glm::vec3> m_normals;
+		std::array<glm::vec3, 3> m_originalVertices;
+		std::array<glm::vec3, 3> m_vertices;
+		std::array<glm::vec3, 3> m_edges;
+		std::array<glm::vec3, 1> m_normals;
 		glm::vec3 m_middle;
 
 		bool m_matricesHasChanged;
@@ -1,9 +1,15 @@
+#include "../pch.h"
 #include "BaseSystem.h"
 
+#include "../DataTypes/Entity.h"
+#include "../Utils/ThreadPool.h"
+
 namespace Scuffed {
 
 	BaseSystem::BaseSystem() {
-
+		m_threadPool = nullptr;
+		m_componentRegistry = nullptr;
+		skipSleepingEntities = false;
 	}
 
 	BaseSystem::~BaseSystem() {
@@ -11,31 +17,96 @@ namespace Scuffed {
 	}
 
 	bool BaseSystem::addEntity(Entity* entity) {
-		for (size_t i = 0; i < entities.size(); i++) {
-			if (entities[i] == entity) {
-				return false;
-			}
+		if (hasEntity(entity)) {
+			return false;
 		}
 
+		m_entityIndices.set(entity->getId(), (int)entities.size());
 		entities.push_back(entity);
 		return true;
 	}
 
+	void BaseSystem::addEntities(const std::vector<Entity*>& newEntities) {
+		entities.reserve(entities.size() + newEntities.size());
+
+		// Goes through addEntity so derived systems still see every entity
+		for (auto e : newEntities) {
+			addEntity(e);
+		}
+	}
+
 	void BaseSystem::removeEntity(Entity* entity) {
-		for (size_t i = 0; i < entities.size(); i++) {
-			if (entities[i] == entity) {
-				entities.erase(entities.begin() + i);
-				break;
-			}
+		if (!hasEntity(entity)) {
+			return;
 		}
+
+		// Swap and pop, iteration order of the remaining entities is not preserved
+		const unsigned int id = entity->getId();
+		const int index = m_entityIndices.get(id);
+		Entity* last = entities.back();
+		entities[index] = last;
+		m_entityIndices.set(last->getId(), index);
+		entities.pop_back();
+		m_entityIndices.remove(id);
+	}
+
+	void BaseSystem::removeEntities(const std::vector<Entity*>& entitiesToRemove) {
+		for (auto e : entitiesToRemove) {
+			removeEntity(e);
+		}
+	}
+
+	bool BaseSystem::hasEntity(Entity* entity) const {
+		return m_entityIndices.get(entity->getId()) >= 0;
 	}
 
 	void BaseSystem::update(float dt) {
 
 	}
 
-	std::unordered_map<std::string, bool>& BaseSystem::getRequiredComponentTypes() {
+	const ComponentMask& BaseSystem::getRequiredComponentTypes() const {
 		return requiredComponents;
 	}
 
+	const ComponentMask& BaseSystem::getReadComponentTypes() const {
+		return readComponents;
+	}
+
+	const ComponentMask& BaseSystem::getWrittenComponentTypes() const {
+		return writtenComponents;
+	}
+
+	void BaseSystem::provideThreadPool(ThreadPool* threadPool) {
+		m_threadPool = threadPool;
+	}
+
+	void BaseSystem::provideComponentRegistry(ComponentRegistry* componentRegistry) {
+		m_componentRegistry = componentRegistry;
+	}
+
+	bool BaseSystem::skipsSleepingEntities() const {
+		return skipSleepingEntities;
+	}
+
+	int BaseSystem::getEntityIndex(Entity* entity) const {
+		return m_entityIndices.get(entity->getId());
+	}
+
+	void BaseSystem::forEachEntity(const std::function<void(Entity*)>& func) {
+		forEachIndex(entities.size(), [&](size_t i) {
+			func(entities[i]);
+		});
+	}
+
+	void BaseSystem::forEachIndex(size_t count, const std::function<void(size_t)>& func) {
+		if (m_threadPool) {
+			m_threadPool->parallelFor(count, func);
+		}
+		else {
+			for (size_t i = 0; i < count; i++) {
+				func(i);
+			}
+		}
+	}
+
 }
\ No newline at end of file
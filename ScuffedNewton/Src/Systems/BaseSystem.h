@@ -1,31 +1,80 @@
 #pragma once
 
 #include <vector>
-#include <unordered_map>
+#include <functional>
+
+#include "../Components/Component.h"
+#include "../DataStructures/ComponentRegistry.h"
 
 namespace Scuffed {
 
 	class Entity;
+	class ThreadPool;
 
 	class BaseSystem {
 	public:
 		BaseSystem();
-		~BaseSystem();
+		virtual ~BaseSystem();
 
 		virtual bool addEntity(Entity* entity);
+		virtual void addEntities(const std::vector<Entity*>& newEntities);
 
 		virtual void removeEntity(Entity* entity);
+		virtual void removeEntities(const std::vector<Entity*>& entitiesToRemove);
+
+		virtual bool hasEntity(Entity* entity) const;
 
 		virtual void update(float dt);
 
-		virtual std::unordered_map<std::string, bool>& getRequiredComponentTypes();
+		virtual const ComponentMask& getRequiredComponentTypes() const;
+		// Component types the system reads and writes in update. Used to find which systems can run at the same time
+		virtual const ComponentMask& getReadComponentTypes() const;
+		virtual const ComponentMask& getWrittenComponentTypes() const;
+
+		virtual void provideThreadPool(ThreadPool* threadPool);
+		virtual void provideComponentRegistry(ComponentRegistry* componentRegistry);
+
+		// If sleeping entities are taken out of the system
+		bool skipsSleepingEntities() const;
+		// Index of the entity in entities, -1 if it is not in this system
+		int getEntityIndex(Entity* entity) const;
+
+	protected:
+		// Calls func for every entity, split over the threads of the thread pool. func may only change the components of the entity it is given
+		void forEachEntity(const std::function<void(Entity*)>& func);
+		// Like forEachEntity, but walks the dense pool of ComponentType and hands func the component and its entity id, so the loop reads the components linearly instead of looking them up through the entity.
+		// ComponentType has to be one of the required components. func may only change the components of the entity it is given
+		template<typename ComponentType>
+		void forEachComponent(const std::function<void(ComponentType*, unsigned int)>& func);
+		// Calls func for every index in [0, count), split over the threads of the thread pool
+		void forEachIndex(size_t count, const std::function<void(size_t)>& func);
 
 	protected:
 		std::vector<Entity*> entities;
-		std::unordered_map<std::string, bool> requiredComponents;
+		ComponentMask requiredComponents;
+		ComponentMask readComponents;
+		ComponentMask writtenComponents;
+		bool skipSleepingEntities;
+
+		ThreadPool* m_threadPool;
+		ComponentRegistry* m_componentRegistry;
 	private:
+		IdMap m_entityIndices; // Entity id -> index in entities. -1 if the entity is not in this system
 
 
 	};
 
+	template<typename ComponentType>
+	inline void BaseSystem::forEachComponent(const std::function<void(ComponentType*, unsigned int)>& func) {
+		ComponentPool<ComponentType>* pool = m_componentRegistry->getPool<ComponentType>();
+
+		// The pool also holds the components of entities that are not in this system, like sleeping ones or ones missing another required component
+		forEachIndex(pool->size(), [&](size_t i) {
+			const unsigned int entityId = pool->entityAt(i);
+			if (m_entityIndices.get(entityId) >= 0) {
+				func(pool->at(i), entityId);
+			}
+		});
+	}
+
 }
\ No newline at end of file
@@ -2,91 +2,313 @@
 
 #include "CollisionSystem.h"
 
+#include <algorithm>
 #include <memory>
 
 #include "../Components/Components.h"
 #include "../DataTypes/Entity.h"
 #include "../Calculations/Intersection.h"
-#include "../DataStructures/Octree.h"
+#include "../DataStructures/Broadphase.h"
 #include "../Shapes/Box.h"
+#include "../Utils/ThreadPool.h"
 
 namespace Scuffed {
 
 	CollisionSystem::CollisionSystem() {
-		requiredComponents["CollisionComponent"] = true;
-		requiredComponents["MovementComponent"] = true;
-		requiredComponents["BoundingBoxComponent"] = true;
-		requiredComponents["TransformComponent"] = true;
-
-		m_octree = nullptr;
+		requiredComponents.set(CollisionComponent::TYPE);
+		requiredComponents.set(MovementComponent::TYPE);
+		requiredComponents.set(BoundingBoxComponent::TYPE);
+		requiredComponents.set(TransformComponent::TYPE);
+
+		readComponents.set(CollidableComponent::TYPE);
+		readComponents.set(MeshComponent::TYPE);
+		writtenComponents.set(CollisionComponent::TYPE);
+		writtenComponents.set(MovementComponent::TYPE);
+		writtenComponents.set(BoundingBoxComponent::TYPE);
+		writtenComponents.set(TransformComponent::TYPE);
+
+		skipSleepingEntities = true;
+
+		m_broadphase = nullptr;
+		m_othersWithinReach = true;
 	}
 
 	CollisionSystem::~CollisionSystem() {
 	}
 
-	void CollisionSystem::provideOctree(Octree* octree) {
-		m_octree = octree;
+	void CollisionSystem::provideBroadphase(Broadphase* broadphase) {
+		m_broadphase = broadphase;
+	}
+
+	CollisionSystem::ThreadData::ThreadData()
+		: triangle(glm::vec3(0.f), glm::vec3(0.f), glm::vec3(0.f))
+		, box(glm::vec3(0.5f), glm::vec3(0.f)) {
 	}
 
 	void CollisionSystem::update(float dt) {
 		// ======================== Collision Update ======================================
-		for (auto& e: entities) {
-			CollisionComponent* collision = e->getComponent<CollisionComponent>();
+		findCollisionCandidates(dt);
+
+		const size_t nrOfThreads = m_threadPool ? (size_t)m_threadPool->getNrOfThreads() : 1;
+		if (m_threadData.size() < nrOfThreads) {
+			m_threadData.resize(nrOfThreads);
+		}
+
+		if (m_threadPool && m_threadPool->getNrOfThreads() > 1) {
+			updateParallel(dt);
+		}
+		else {
+			updateSerial(dt);
+		}
+	}
+
+	void CollisionSystem::findCollisionCandidates(float dt) {
+		const size_t count = entities.size();
+		m_reachMins.resize(count);
+		m_reachMaxes.resize(count);
+		if (m_candidates.size() < count) {
+			m_candidates.resize(count);
+		}
+
+		for (size_t i = 0; i < count; i++) {
+			Entity* e = entities[i];
 			MovementComponent* movement = e->getComponent<MovementComponent>();
-			
-			collision->collisions.clear();
+			Box* boundingBox = e->getComponent<BoundingBoxComponent>()->getBoundingBox();
+			if (glm::length2(movement->angularVelocity) > 0.f) {
+				TransformComponent* transform = e->getComponent<TransformComponent>();
+				Broadphase::getReach(boundingBox, movement->velocity, transform->getTranslation() + transform->getCenter(), movement->angularVelocity, dt, m_reachMins[i], m_reachMaxes[i]);
+			}
+			else {
+				Broadphase::getReach(boundingBox, movement->velocity, dt, m_reachMins[i], m_reachMaxes[i]);
+			}
+			m_candidates[i].clear();
+		}
+
+		m_othersWithinReach = true;
+
+		m_pairs.clear();
+		m_broadphase->getPairs(entities, m_reachMins, m_reachMaxes, m_pairs);
+
+		for (auto& pair : m_pairs) {
+			m_candidates[getEntityIndex(pair.entity1)].push_back(pair.entity2);
+
+			int index2 = getEntityIndex(pair.entity2);
+			if (index2 >= 0 && m_broadphase->hasEntity(pair.entity1)) {
+				m_candidates[index2].push_back(pair.entity1);
+			}
+		}
+	}
+
+	void CollisionSystem::getNextCollision(EntityState& state, std::vector<Broadphase::CollisionInfo>& collisions, float& time, std::vector<Broadphase::CollisionInfo>& zeroDistances, const float dt) {
+		Box* boundingBox = state.boundingBox;
+		const glm::vec3& velocity = state.movement->velocity;
+		const glm::vec3& angularVelocity = state.movement->angularVelocity;
+		bool doSimpleCollisions = state.collision->doSimpleCollisions;
+
+		if (glm::length2(angularVelocity) > 0.f) {
+			// Turning entities are swept against everything within their reach, the candidates were only found for other entities
+			glm::vec3 pivot = state.transform->getTranslation() + state.transform->getCenter();
+			glm::vec3 min, max;
+			Broadphase::getReach(boundingBox, velocity, pivot, angularVelocity, dt, min, max);
+			if (state.updatedInPlace && !(glm::all(glm::greaterThanEqual(min, m_reachMins[state.index])) && glm::all(glm::lessThanEqual(max, m_reachMaxes[state.index])))) {
+				m_othersWithinReach = false;
+			}
+
+			m_broadphase->getNextRotatingCollision(state.entity, boundingBox, velocity, pivot, angularVelocity, collisions, time, zeroDistances, dt, doSimpleCollisions);
+			if (zeroDistances.empty()) {
+				return;
+			}
+
+			// The sweep can't see whether turning goes into something the entity already touches, and there is no angular response to collisions.
+			// Only the spin around the contact normal is kept, which turns the touching faces along each other. Touching things with different normals stops the spin,
+			// since no spin turns along all of them. Parallel normals, like a box between two walls, keep the spin around them
+			const glm::vec3 normal = Intersection::separatingAxis(boundingBox, zeroDistances[0].getShape(state.threadData->triangle, state.threadData->box));
+			glm::vec3 spin = normal * Intersection::dot(angularVelocity, normal);
+			for (size_t i = 1; i < zeroDistances.size(); i++) {
+				const glm::vec3 otherNormal = Intersection::separatingAxis(boundingBox, zeroDistances[i].getShape(state.threadData->triangle, state.threadData->box));
+				if (glm::abs(Intersection::dot(normal, otherNormal)) < 0.999f) {
+					spin = glm::vec3(0.f);
+					break;
+				}
+			}
+			state.movement->angularVelocity = spin;
+
+			// Find the collisions again with what is left of the spin. The contacts found then are among the ones above, so the spin turns along all of them
+			time = INFINITY;
+			collisions.clear();
+			zeroDistances.clear();
+			if (glm::length2(spin) > 0.f) {
+				m_broadphase->getNextRotatingCollision(state.entity, boundingBox, velocity, pivot, spin, collisions, time, zeroDistances, dt, doSimpleCollisions);
+				return;
+			}
+		}
+
+		// The candidates are enough as long as the movement stays within the reach found at the start of the update
+		glm::vec3 min(INFINITY), max(-INFINITY);
+		for (const auto& vertex : boundingBox->getVertices()) {
+			min = glm::min(min, vertex);
+			max = glm::max(max, vertex);
+		}
+		glm::vec3 movedDistance = velocity * dt;
+		min = glm::min(min, min + movedDistance);
+		max = glm::max(max, max + movedDistance);
+
+		if (m_othersWithinReach && glm::all(glm::greaterThanEqual(min, m_reachMins[state.index])) && glm::all(glm::lessThanEqual(max, m_reachMaxes[state.index]))) {
+			m_broadphase->getNextContinousCollisionWithEntities(state.entity, boundingBox, velocity, m_candidates[state.index], collisions, time, zeroDistances, dt, doSimpleCollisions);
+		}
+		else {
+			if (state.updatedInPlace) {
+				m_othersWithinReach = false;
+			}
+			m_broadphase->getNextContinousCollision(state.entity, boundingBox, velocity, collisions, time, zeroDistances, dt, doSimpleCollisions);
+		}
+	}
 
-			// Continous collisions
-			movement->updateableDt = dt;
-			continousCollisionUpdate(e, movement->updateableDt);
-			movement->oldVelocity = movement->velocity;
+	void CollisionSystem::updateSerial(float dt) {
+		// Entities are updated in place, so every entity sees the entities before it at their new positions
+		for (size_t i = 0; i < entities.size(); i++) {
+			Entity* e = entities[i];
+
+			EntityState state;
+			state.index = i;
+			state.updatedInPlace = true;
+			state.entity = e;
+			state.boundingBox = e->getComponent<BoundingBoxComponent>()->getBoundingBox();
+			state.transform = e->getComponent<TransformComponent>();
+			state.movement = e->getComponent<MovementComponent>();
+			state.collision = e->getComponent<CollisionComponent>();
+			state.threadData = &m_threadData[0];
+
+			updateEntity(state, dt);
+		}
+	}
+
+	void CollisionSystem::updateParallel(float dt) {
+		// Every entity is updated against the state all entities had at the start of the update, using its own copies of the components that other entities read.
+		// The copies are written back in entity order afterwards, so the result does not depend on the number of threads or how the work was split
+		const size_t count = entities.size();
+		if (m_boundingBoxCopies.size() < count) {
+			m_boundingBoxCopies.resize(count, Box(glm::vec3(0.5f), glm::vec3(0.f)));
+			m_transformCopies.resize(count);
+			m_movementCopies.resize(count);
+		}
+
+		m_broadphase->beginConcurrentQueries();
 
-			// Handle friction
-			handleCollisions(e, collision->collisions, dt);
+		m_threadPool->parallelFor(count, [&](size_t i) {
+			Entity* e = entities[i];
 
-			surfaceFromCollision(e, e->getComponent<BoundingBoxComponent>()->getBoundingBox(), collision->collisions);
+			m_boundingBoxCopies[i] = *e->getComponent<BoundingBoxComponent>()->getBoundingBox();
+			m_transformCopies[i] = *e->getComponent<TransformComponent>();
+			m_movementCopies[i] = *e->getComponent<MovementComponent>();
 
-			updateManifolds(e, e->getComponent<BoundingBoxComponent>()->getBoundingBox(), collision->collisions);
+			EntityState state;
+			state.index = i;
+			state.updatedInPlace = false; // Other entities only see the state from the start of the update
+			state.entity = e;
+			state.boundingBox = &m_boundingBoxCopies[i];
+			state.transform = &m_transformCopies[i];
+			state.movement = &m_movementCopies[i];
+			state.collision = e->getComponent<CollisionComponent>(); // Only read by the entity itself
+			state.threadData = &m_threadData[m_threadPool->getThreadIndex()];
+
+			updateEntity(state, dt);
+		});
+
+		m_broadphase->endConcurrentQueries();
+
+		for (size_t i = 0; i < count; i++) {
+			Entity* e = entities[i];
+			*e->getComponent<BoundingBoxComponent>()->getBoundingBox() = m_boundingBoxCopies[i];
+			static_cast<Transform&>(*e->getComponent<TransformComponent>()) = m_transformCopies[i];
+			*e->getComponent<MovementComponent>() = m_movementCopies[i];
 		}
 	}
 
-	void CollisionSystem::continousCollisionUpdate(Entity* e, float& dt) {
-		Box* boundingBox = e->getComponent<BoundingBoxComponent>()->getBoundingBox();
-		CollisionComponent* collision = e->getComponent<CollisionComponent>();
-		MovementComponent* movement = e->getComponent<MovementComponent>();
-		TransformComponent* transform = e->getComponent<TransformComponent>();
+	void CollisionSystem::updateEntity(EntityState& state, float dt) {
+		CollisionComponent* collision = state.collision;
+		MovementComponent* movement = state.movement;
+
+		collision->collisions.clear();
+
+		// Forget the meshes that weren't close last update
+		auto& cache = collision->contactCache;
+		cache.erase(std::remove_if(cache.begin(), cache.end(), [](const Broadphase::CachedTriangles& cached) { return !cached.used; }), cache.end());
+		for (auto& cached : cache) {
+			cached.used = false;
+		}
+
+		// Continous collisions
+		movement->updateableDt = dt;
+		continousCollisionUpdate(state, movement->updateableDt);
+		movement->oldVelocity = movement->velocity;
+
+		// Handle friction
+		handleCollisions(state, collision->collisions, dt);
+
+		surfaceFromCollision(state, collision->collisions);
+
+		updateManifolds(state, collision->collisions);
+	}
+
+	void CollisionSystem::continousCollisionUpdate(EntityState& state, float& dt) {
+		Box* boundingBox = state.boundingBox;
+		CollisionComponent* collision = state.collision;
+		MovementComponent* movement = state.movement;
+		Transform* transform = state.transform;
 
 		float time = INFINITY;
 
-		std::vector<Octree::CollisionInfo> collisions;
-		std::vector<Octree::CollisionInfo> zeroDistances;
+		std::vector<Broadphase::CollisionInfo>& collisions = state.threadData->collisions;
+		std::vector<Broadphase::CollisionInfo>& zeroDistances = state.threadData->zeroDistances;
+		collisions.clear();
+		zeroDistances.clear();
 
-		m_octree->getNextContinousCollision(e, collisions, time, zeroDistances, dt, collision->doSimpleCollisions);
+		getNextCollision(state, collisions, time, zeroDistances, dt);
 
-		if (handleCollisions(e, zeroDistances, 0.f)) {
+		if (handleCollisions(state, zeroDistances, 0.f)) {
 			// Clear
 			time = INFINITY;
 			zeroDistances.clear();
 			collisions.clear();
 
-			m_octree->getNextContinousCollision(e, collisions, time, zeroDistances, dt, collision->doSimpleCollisions);
+			getNextCollision(state, collisions, time, zeroDistances, dt);
 		}
 
 		// Save zeroes
 		collision->collisions.insert(collision->collisions.end(), zeroDistances.begin(), zeroDistances.end());
 
 		while (time <= dt && time > 0.f) {
+			// No collisions means a turning entity could only be advanced this far safely, it is moved there without being pushed into anything
+			const bool hit = !collisions.empty();
+
 			// Move entity to collision
 			glm::vec3 additionalMovement(0.f);
-			additionalMovement = glm::normalize(movement->velocity) * 0.0001f;
+			if (hit && glm::length2(movement->velocity) > 0.f) {
+				// Turning entities can hit things without moving
+				additionalMovement = glm::normalize(movement->velocity) * 0.0001f;
+			}
 			transform->translate(movement->velocity * time + additionalMovement);
+
+			const float angularSpeed = glm::length(movement->angularVelocity);
+			if (angularSpeed > 0.f) {
+				transform->rotate(glm::angleAxis(angularSpeed * time, movement->angularVelocity / angularSpeed));
+
+				if (hit) {
+					// There is no angular response to collisions, so the spin stops instead of turning the rest of the way into what it hit
+					movement->angularVelocity = glm::vec3(0.f);
+				}
+			}
+
 			boundingBox->setBaseMatrix(transform->getMatrixWithUpdate());
 			//boundingBox->setTranslation(boundingBox->getMiddle() + movement->velocity * time);
 
 			// Decrease time
 			dt -= time;
 
-			handleCollisions(e, collisions, 0.f);
+			if (hit) {
+				handleCollisions(state, collisions, 0.f);
+			}
 			
 			// Save collisions to collision component
 			collision->collisions.insert(collision->collisions.end(), collisions.begin(), collisions.end());
@@ -97,25 +319,25 @@ namespace Scuffed {
 			collisions.clear();
 
 			// Check for next collision
-			m_octree->getNextContinousCollision(e, collisions, time, zeroDistances, dt, collision->doSimpleCollisions);
+			getNextCollision(state, collisions, time, zeroDistances, dt);
 		}
 	}
 
-	bool CollisionSystem::handleCollisions(Entity* e, std::vector<Octree::CollisionInfo>& collisions, const float dt) {
-		MovementComponent* movement = e->getComponent<MovementComponent>();
-		CollisionComponent* collision = e->getComponent<CollisionComponent>();
-		Box* boundingBox = e->getComponent<BoundingBoxComponent>()->getBoundingBox();
+	bool CollisionSystem::handleCollisions(EntityState& state, std::vector<Broadphase::CollisionInfo>& collisions, const float dt) {
+		MovementComponent* movement = state.movement;
+		CollisionComponent* collision = state.collision;
 
 		collision->onGround = false;
 
 		const size_t collisionCount = collisions.size();
 
 		if (collisionCount > 0) {
-			std::vector<int> groundIndices;
+			std::vector<int>& groundIndices = state.threadData->groundIndices;
+			groundIndices.clear();
 			glm::vec3 sumVec(0.0f);
 
 			// Gather info
-			gatherCollisionInformation(e, boundingBox, collisions, sumVec, groundIndices, dt);
+			gatherCollisionInformation(state, collisions, sumVec, groundIndices, dt);
 
 			if (groundIndices.size() > 0) {
 				collision->onGround = true;
@@ -124,7 +346,7 @@ namespace Scuffed {
 			glm::vec3 preVel = movement->velocity;
 
 			// Handle true collisions
-			updateVelocityVec(e, movement->velocity, collisions, sumVec, groundIndices, dt);
+			updateVelocityVec(state, movement->velocity, collisions, sumVec, groundIndices, dt);
 
 			if (glm::length2(movement->velocity) > 0.0f && Intersection::dot(glm::normalize(preVel), glm::normalize(movement->velocity)) < 1.f) {
 				// Collisions effected movement
@@ -136,15 +358,16 @@ namespace Scuffed {
 		return false;
 	}
 
-	void CollisionSystem::gatherCollisionInformation(Entity* e, Box* boundingBox, std::vector<Octree::CollisionInfo>& collisions, glm::vec3& sumVec, std::vector<int>& groundIndices, const float dt) {
+	void CollisionSystem::gatherCollisionInformation(EntityState& state, std::vector<Broadphase::CollisionInfo>& collisions, glm::vec3& sumVec, std::vector<int>& groundIndices, const float dt) {
+		Box* boundingBox = state.boundingBox;
 		size_t collisionCount = collisions.size();
 
 		if (collisionCount > 0) {
 			// Get the actual intersection axises
 			for (size_t i = 0; i < collisionCount; i++) {
-				Octree::CollisionInfo& collisionInfo_i = collisions[i];
+				Broadphase::CollisionInfo& collisionInfo_i = collisions[i];
 
-				if (Intersection::SAT(boundingBox, collisionInfo_i.shape.get(), &collisionInfo_i.intersectionAxis, &collisionInfo_i.intersectionDepth)) {
+				if (Intersection::SAT(boundingBox, collisionInfo_i.getShape(state.threadData->triangle, state.threadData->box), &collisionInfo_i.intersectionAxis, &collisionInfo_i.intersectionDepth)) {
 					//if (collisionInfo_i.shape.get()->getVertices().size() == 3) {
 					//	// Triangle, make sure collision is along normal
 					//	if (glm::dot(collisionInfo_i.intersectionAxis, collisionInfo_i.shape.get()->getNormals()[0]) < 0.f) {
@@ -182,14 +405,14 @@ namespace Scuffed {
 		}
 	}
 
-	void CollisionSystem::updateVelocityVec(Entity* e, glm::vec3& velocity, std::vector<Octree::CollisionInfo>& collisions, glm::vec3& sumVec, std::vector<int>& groundIndices, const float dt) {
-		CollisionComponent* collision = e->getComponent<CollisionComponent>();
+	void CollisionSystem::updateVelocityVec(EntityState& state, glm::vec3& velocity, std::vector<Broadphase::CollisionInfo>& collisions, glm::vec3& sumVec, std::vector<int>& groundIndices, const float dt) {
+		CollisionComponent* collision = state.collision;
 
 		const size_t collisionCount = collisions.size();
 
 		// Loop through collisions and handle them
 		for (size_t i = 0; i < collisionCount; i++) {
-			const Octree::CollisionInfo& collisionInfo_i = collisions[i];
+			const Broadphase::CollisionInfo& collisionInfo_i = collisions[i];
 
 			// ----Velocity changes from collisions----
 
@@ -221,7 +444,7 @@ namespace Scuffed {
 		if (collision->onGround) { // Ground drag
 			size_t nrOfGroundCollisions = groundIndices.size();
 			for (size_t i = 0; i < nrOfGroundCollisions; i++) {
-				const Octree::CollisionInfo& collisionInfo_ground_i = collisions[groundIndices[i]];
+				const Broadphase::CollisionInfo& collisionInfo_ground_i = collisions[groundIndices[i]];
 				const glm::vec3 velAlongPlane = velocity - collisionInfo_ground_i.intersectionAxis * glm::dot(collisionInfo_ground_i.intersectionAxis, velocity);
 				const float sizeOfVel = glm::length(velAlongPlane);
 				if (sizeOfVel > 0.0f) {
@@ -234,17 +457,18 @@ namespace Scuffed {
 	}
 
 
-	glm::vec3 CollisionSystem::surfaceFromCollision(Entity* e, Box* boundingBox, std::vector<Octree::CollisionInfo>& collisions) {
+	glm::vec3 CollisionSystem::surfaceFromCollision(EntityState& state, std::vector<Broadphase::CollisionInfo>& collisions) {
 		glm::vec3 distance(0.0f);
-		TransformComponent* transform = e->getComponent<TransformComponent>();
+		Box* boundingBox = state.boundingBox;
+		Transform* transform = state.transform;
 
 		const size_t count = collisions.size();
 		for (size_t i = 0; i < count; i++) {
-			const Octree::CollisionInfo& collisionInfo_i = collisions[i];
+			const Broadphase::CollisionInfo& collisionInfo_i = collisions[i];
 			float depth;
 			glm::vec3 axis;
 
-			if (Intersection::SAT(boundingBox, collisionInfo_i.shape.get(), &axis, &depth)) {
+			if (Intersection::SAT(boundingBox, collisionInfo_i.getShape(state.threadData->triangle, state.threadData->box), &axis, &depth)) {
 				transform->translate(axis * depth);	
 				boundingBox->setBaseMatrix(transform->getMatrixWithUpdate());
 				distance += axis * depth;
@@ -257,17 +481,18 @@ namespace Scuffed {
 		return distance;
 	}
 
-	void CollisionSystem::updateManifolds(Entity* e, Box* boundingBox, std::vector<Octree::CollisionInfo>& collisions) {
-		CollisionComponent* collision = e->getComponent<CollisionComponent>();
+	void CollisionSystem::updateManifolds(EntityState& state, std::vector<Broadphase::CollisionInfo>& collisions) {
+		Box* boundingBox = state.boundingBox;
+		CollisionComponent* collision = state.collision;
 		collision->manifolds.clear();
 
-		std::vector<glm::vec3> manifolds;
+		std::vector<glm::vec3>& manifolds = state.threadData->manifolds;
 
 		const size_t count = collisions.size();
 		for (size_t i = 0; i < count; i++) {
-			const Octree::CollisionInfo& collisionInfo_i = collisions[i];
+			const Broadphase::CollisionInfo& collisionInfo_i = collisions[i];
 			manifolds.clear();
-			Intersection::SAT(boundingBox, collisionInfo_i.shape.get(), manifolds);
+			Intersection::SAT(boundingBox, collisionInfo_i.getShape(state.threadData->triangle, state.threadData->box), manifolds);
 			collision->manifolds.insert(collision->manifolds.end(), manifolds.begin(), manifolds.end());
 		}
 
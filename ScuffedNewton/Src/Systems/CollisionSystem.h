@@ -1,28 +1,84 @@
 #pragma once
 
 #include "BaseSystem.h"
-#include "../DataStructures/Octree.h"
+#include "../DataStructures/Broadphase.h"
+#include "../Shapes/Box.h"
+#include "../Shapes/Triangle.h"
+#include "../DataTypes/Transform.h"
+#include "../Components/MovementComponent.h"
 
 namespace Scuffed {
 
+	class CollisionComponent;
+
 	class CollisionSystem : public BaseSystem {
 	public:
 		CollisionSystem();
 		~CollisionSystem();
 
-		void provideOctree(Octree* octree);
+		void provideBroadphase(Broadphase* broadphase);
 		void update(float dt);
 
 	private:
-		void continousCollisionUpdate(Entity* e, float& dt);
-		bool handleCollisions(Entity* e, std::vector<Octree::CollisionInfo>& collisions, const float dt);
-		void gatherCollisionInformation(Entity* e, Box* boundingBox, std::vector<Octree::CollisionInfo>& collisions, glm::vec3& sumVec, std::vector<int>& groundIndices, const float dt);
-		void updateVelocityVec(Entity* e, glm::vec3& velocity, std::vector<Octree::CollisionInfo>& collisions, glm::vec3& sumVec, std::vector<int>& groundIndices, const float dt);
-		glm::vec3 surfaceFromCollision(Entity* e, Box* boundingBox, std::vector<Octree::CollisionInfo>& collisions);
-		void updateManifolds(Entity* e, Box* boundingBox, std::vector<Octree::CollisionInfo>& collisions);
+		// Memory reused by the collision functions on one thread, kept between updates
+		struct ThreadData {
+			ThreadData();
+
+			std::vector<Broadphase::CollisionInfo> collisions;
+			std::vector<Broadphase::CollisionInfo> zeroDistances;
+			std::vector<int> groundIndices;
+			std::vector<glm::vec3> manifolds;
+
+			// Collision records are turned into these to run SAT on them
+			Triangle triangle;
+			Box box;
+		};
+
+		// What the collision functions read and write for an entity.
+		// Points to the entity's components when updating serially, and to copies of them when updating in parallel
+		struct EntityState {
+			size_t index; // Index in entities
+			bool updatedInPlace; // If the other entities see the changes immediately
+			Entity* entity;
+			Box* boundingBox;
+			Transform* transform;
+			MovementComponent* movement;
+			CollisionComponent* collision;
+			ThreadData* threadData;
+		};
+
+		void findCollisionCandidates(float dt);
+		void getNextCollision(EntityState& state, std::vector<Broadphase::CollisionInfo>& collisions, float& time, std::vector<Broadphase::CollisionInfo>& zeroDistances, const float dt);
+
+		void updateSerial(float dt);
+		void updateParallel(float dt);
+		void updateEntity(EntityState& state, float dt);
+
+		void continousCollisionUpdate(EntityState& state, float& dt);
+		bool handleCollisions(EntityState& state, std::vector<Broadphase::CollisionInfo>& collisions, const float dt);
+		void gatherCollisionInformation(EntityState& state, std::vector<Broadphase::CollisionInfo>& collisions, glm::vec3& sumVec, std::vector<int>& groundIndices, const float dt);
+		void updateVelocityVec(EntityState& state, glm::vec3& velocity, std::vector<Broadphase::CollisionInfo>& collisions, glm::vec3& sumVec, std::vector<int>& groundIndices, const float dt);
+		glm::vec3 surfaceFromCollision(EntityState& state, std::vector<Broadphase::CollisionInfo>& collisions);
+		void updateManifolds(EntityState& state, std::vector<Broadphase::CollisionInfo>& collisions);
 
 	private:
-		Octree* m_octree;
+		Broadphase* m_broadphase;
+
+		// Per entity copies used by updateParallel, indexed like entities. Kept between updates to reuse their memory
+		std::vector<Box> m_boundingBoxCopies;
+		std::vector<Transform> m_transformCopies;
+		std::vector<MovementComponent> m_movementCopies;
+
+		std::vector<ThreadData> m_threadData; // One per thread in the thread pool
+
+		// Found once per update from the broadphase pairs, indexed like entities.
+		// An entity only has to be tested against its candidates as long as it stays within its reach
+		std::vector<Broadphase::EntityPair> m_pairs;
+		std::vector<std::vector<Entity*>> m_candidates;
+		std::vector<glm::vec3> m_reachMins;
+		std::vector<glm::vec3> m_reachMaxes;
+		// Cleared when an entity updated in place leaves its reach, since the later entities' candidates might then miss it
+		bool m_othersWithinReach;
 	};
 
-}
\ No newline at end of file
+}
@@ -12,16 +12,22 @@
 namespace Scuffed {
 
 	MovementPostCollisionSystem::MovementPostCollisionSystem() {
-		requiredComponents["TransformComponent"] = true;
-		requiredComponents["MovementComponent"] = true;
+		requiredComponents.set(TransformComponent::TYPE);
+		requiredComponents.set(MovementComponent::TYPE);
+
+		writtenComponents.set(TransformComponent::TYPE);
+		writtenComponents.set(MovementComponent::TYPE);
+
+		skipSleepingEntities = true;
 	}
 
 	void MovementPostCollisionSystem::update(float dt) {
 		//std::cout << "MovementPostCollision system ran\n";
 
-		for (auto& e : entities) {
-			TransformComponent* transform = e->getComponent<TransformComponent>();
-			MovementComponent* movement = e->getComponent<MovementComponent>();
+		ComponentPool<TransformComponent>* transforms = m_componentRegistry->getPool<TransformComponent>();
+
+		forEachComponent<MovementComponent>([&](MovementComponent* movement, unsigned int entityId) {
+			TransformComponent* transform = transforms->get(entityId);
 
 			//momentum(e, dt);
 
@@ -30,6 +36,12 @@ namespace Scuffed {
 				transform->rotate(movement->rotation * dt);
 			}
 
+			// Turn for the time the collision system found free, like the translation below
+			const float angularSpeed = glm::length(movement->angularVelocity);
+			if (angularSpeed > 0.f) {
+				transform->rotate(glm::angleAxis(angularSpeed * movement->updateableDt, movement->angularVelocity / angularSpeed));
+			}
+
 			// Apply air drag
 			float saveY = movement->velocity.y;
 			movement->velocity.y = 0;
@@ -50,7 +62,7 @@ namespace Scuffed {
 			movement->oldMovement = translation;
 
 			movement->oldVelocity = movement->velocity;
-		}
+		});
 	}
 
 	void MovementPostCollisionSystem::momentum(Entity* e, float dt) {
@@ -8,17 +8,18 @@
 namespace Scuffed {
 
 	MovementSystem::MovementSystem() {
-		requiredComponents["TransformComponent"] = true;
-		requiredComponents["MovementComponent"] = true;
+		requiredComponents.set(TransformComponent::TYPE);
+		requiredComponents.set(MovementComponent::TYPE);
+
+		writtenComponents.set(MovementComponent::TYPE);
+
+		skipSleepingEntities = true;
 	}
 
 	void MovementSystem::update(float dt) {
 		//std::cout << "Movement system ran\n";
 
-		for (auto& e : entities) {
-			TransformComponent* transform = e->getComponent<TransformComponent>();
-			MovementComponent* movement = e->getComponent<MovementComponent>();
-
+		forEachComponent<MovementComponent>([&](MovementComponent* movement, unsigned int /*entityId*/) {
 			// Update velocity
 			movement->velocity += (movement->constantAcceleration + movement->accelerationToAdd) * dt;
 
@@ -27,7 +28,7 @@ namespace Scuffed {
 
 			// Set initial value which might be changed in CollisionSystem
 			movement->updateableDt = dt;
-		}
+		});
 	}
 
 }
\ No newline at end of file
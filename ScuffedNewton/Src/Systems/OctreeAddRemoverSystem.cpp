@@ -2,33 +2,40 @@
 #include "OctreeAddRemoverSystem.h"
 
 #include "../DataTypes/Entity.h"
+#include "../DataStructures/Broadphase.h"
 
 #include "../components/Components.h"
 
 namespace Scuffed {
 
 	OctreeAddRemoverSystem::OctreeAddRemoverSystem() {
-		requiredComponents["BoundingBoxComponent"] = true;
-		requiredComponents["CollidableComponent"] = true;
+		requiredComponents.set(BoundingBoxComponent::TYPE);
+		requiredComponents.set(CollidableComponent::TYPE);
+
+		// The broadphase is not a component. Updating it clears the change flag of the bounding boxes, which also orders this system against the systems using the broadphase.
+		// Sweep and prune reads the velocities to sweep the boxes it sorts
+		readComponents.set(CollidableComponent::TYPE);
+		readComponents.set(MovementComponent::TYPE);
+		writtenComponents.set(BoundingBoxComponent::TYPE);
 
 		m_doCulling = false;
 		m_cullCamera = nullptr;
-		m_octree = nullptr;
+		m_broadphase = nullptr;
 	}
 
 	OctreeAddRemoverSystem::~OctreeAddRemoverSystem() {
 
 	}
 
-	void OctreeAddRemoverSystem::provideOctree(Octree* octree) {
-		m_octree = octree;
-		m_octree->addEntities(&entities);
+	void OctreeAddRemoverSystem::provideBroadphase(Broadphase* broadphase) {
+		m_broadphase = broadphase;
+		m_broadphase->addEntities(&entities);
 	}
 
 	bool OctreeAddRemoverSystem::addEntity(Entity* entity) {
 		if (BaseSystem::addEntity(entity)) {
-			if (m_octree) {
-				m_octree->addEntity(entity);
+			if (m_broadphase) {
+				m_broadphase->addEntity(entity);
 				return true;
 			}
 		}
@@ -36,16 +43,20 @@ namespace Scuffed {
 	}
 
 	void OctreeAddRemoverSystem::removeEntity(Entity* entity) {
+		if (!hasEntity(entity)) {
+			return;
+		}
+
 		BaseSystem::removeEntity(entity);
 
-		if (m_octree) {
-			m_octree->removeEntity(entity);
+		if (m_broadphase) {
+			m_broadphase->removeEntity(entity);
 		}
 	}
 
 
 	void OctreeAddRemoverSystem::update(float dt) {
-		m_octree->update();
+		m_broadphase->update(dt);
 	}
 
 	void OctreeAddRemoverSystem::updatePerFrame(float dt) {
@@ -57,7 +68,7 @@ namespace Scuffed {
 		//			cullComponent->isVisible = false;
 		//		}
 		//	}
-		//	m_octree->frustumCulledDraw(*m_cullCamera);
+		//	m_broadphase->frustumCulledDraw(*m_cullCamera);
 		//}
 		assert(false); //Not implemented correctly
 	}
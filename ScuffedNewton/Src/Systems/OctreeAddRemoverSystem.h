@@ -3,15 +3,16 @@
 
 namespace Scuffed {
 
-	class Octree;
+	class Broadphase;
 	class Camera;
 
+	// Keeps the scene's broadphase (octree or AABB tree) in sync with the collidable entities
 	class OctreeAddRemoverSystem : public BaseSystem {
 	public:
 		OctreeAddRemoverSystem();
 		~OctreeAddRemoverSystem();
 
-		void provideOctree(Octree* octree);
+		void provideBroadphase(Broadphase* broadphase);
 
 		bool addEntity(Entity* entity) override;
 
@@ -23,7 +24,7 @@ namespace Scuffed {
 		void setCulling(bool activated, Camera* camera);
 
 	private:
-		Octree* m_octree;
+		Broadphase* m_broadphase;
 		bool m_doCulling;
 		Camera* m_cullCamera;
 	};
@@ -0,0 +1,269 @@
+#include "../pch.h"
+#include "SleepSystem.h"
+
+#include "../Components/Components.h"
+#include "../DataStructures/Scene.h"
+#include "../DataTypes/Entity.h"
+
+namespace Scuffed {
+
+	SleepSystem::SleepSystem() {
+		requiredComponents.set(TransformComponent::TYPE);
+		requiredComponents.set(MovementComponent::TYPE);
+		requiredComponents.set(CollisionComponent::TYPE);
+
+		// Writing the movement component makes every system moving the entities wait for the sleeping entities to be taken out of them
+		readComponents.set(TransformComponent::TYPE);
+		readComponents.set(CollisionComponent::TYPE);
+		writtenComponents.set(MovementComponent::TYPE);
+
+		m_scene = nullptr;
+		m_sleepSpeed = 0.f;
+		m_sleepTime = 0.f;
+	}
+
+	SleepSystem::~SleepSystem() {
+
+	}
+
+	void SleepSystem::provideScene(Scene* scene) {
+		m_scene = scene;
+	}
+
+	void SleepSystem::setSleepThresholds(float speed, float time) {
+		m_sleepSpeed = speed;
+		m_sleepTime = time;
+	}
+
+	bool SleepSystem::addEntity(Entity* entity) {
+		if (!BaseSystem::addEntity(entity)) {
+			return false;
+		}
+
+		// Only sleeping already if the systems were recreated. This system is first, so the systems after it add the entity as awake
+		MovementComponent* movement = entity->getComponent<MovementComponent>();
+		movement->sleeping = false;
+		movement->restingTime = 0.f;
+		return true;
+	}
+
+	void SleepSystem::removeEntity(Entity* entity) {
+		if (!hasEntity(entity)) {
+			return;
+		}
+
+		// Whatever rested on the entity can start moving again
+		auto it = m_islandByEntity.find(entity);
+		if (it != m_islandByEntity.end()) {
+			wakeIsland(it->second);
+		}
+
+		BaseSystem::removeEntity(entity);
+	}
+
+	void SleepSystem::update(float dt) {
+		if (m_sleepTime <= 0.f) {
+			// Sleeping is turned off
+			for (int i = 0; i < (int)m_islands.size(); i++) {
+				if (!m_islands[i].empty()) {
+					wakeIsland(i);
+				}
+			}
+			m_removedEntities.clear();
+			return;
+		}
+
+		wakeChangedIslands();
+		putIslandsToSleep(dt);
+		m_removedEntities.clear();
+	}
+
+	void SleepSystem::wakeIslandsTouching(Entity* entity) {
+		auto range = m_islandsByContact.equal_range(entity);
+		while (range.first != range.second) {
+			// Waking removes the island's contacts from the map
+			wakeIsland(range.first->second);
+			range = m_islandsByContact.equal_range(entity);
+		}
+	}
+
+	void SleepSystem::prepareRemoval(Entity* entity) {
+		wakeIslandsTouching(entity);
+		m_removedEntities.insert(entity);
+	}
+
+	void SleepSystem::wakeChangedIslands() {
+		for (int i = 0; i < (int)m_islands.size(); i++) {
+			bool changed = false;
+			for (size_t j = 0; j < m_islands[i].size() && !changed; j++) {
+				const SleepingEntity& sleeping = m_islands[i][j];
+				MovementComponent* movement = sleeping.entity->getComponent<MovementComponent>();
+				TransformComponent* transform = sleeping.entity->getComponent<TransformComponent>();
+
+				changed = movement->velocity != glm::vec3(0.f) || movement->accelerationToAdd != glm::vec3(0.f) || movement->angularVelocity != glm::vec3(0.f) ||
+					transform->getTranslation() != sleeping.translation;
+			}
+
+			// Static and kinematic entities the island rests on are never awake in this system, so they are only noticed by being moved
+			for (size_t j = 0; j < m_islandContacts[i].size() && !changed; j++) {
+				const SleepingEntity& contact = m_islandContacts[i][j];
+				TransformComponent* transform = contact.entity->getComponent<TransformComponent>();
+				changed = transform && transform->getTranslation() != contact.translation;
+			}
+
+			if (changed) {
+				wakeIsland(i);
+			}
+		}
+
+		// An awake entity touching a sleeping one might push it or have been what it rested on
+		for (auto e : entities) {
+			if (e->getComponent<MovementComponent>()->sleeping) {
+				continue;
+			}
+
+			for (auto& collision : e->getComponent<CollisionComponent>()->collisions) {
+				auto it = m_islandByEntity.find(collision.entity);
+				if (it != m_islandByEntity.end()) {
+					wakeIsland(it->second);
+				}
+			}
+		}
+	}
+
+	void SleepSystem::wakeIsland(int island) {
+		for (auto& sleeping : m_islands[island]) {
+			m_islandByEntity.erase(sleeping.entity);
+			sleeping.entity->getComponent<MovementComponent>()->restingTime = 0.f;
+			m_scene->setSleeping(sleeping.entity, false);
+		}
+
+		m_islands[island].clear();
+
+		for (auto& contact : m_islandContacts[island]) {
+			auto range = m_islandsByContact.equal_range(contact.entity);
+			for (auto it = range.first; it != range.second; ++it) {
+				if (it->second == island) {
+					m_islandsByContact.erase(it);
+					break;
+				}
+			}
+		}
+		m_islandContacts[island].clear();
+
+		m_freeIslands.push_back(island);
+	}
+
+	void SleepSystem::addIslandContact(int island, Entity* entity) {
+		if (m_removedEntities.count(entity) > 0 || hasEntity(entity)) {
+			return;
+		}
+
+		std::vector<SleepingEntity>& contacts = m_islandContacts[island];
+		for (auto& contact : contacts) {
+			if (contact.entity == entity) {
+				return;
+			}
+		}
+
+		TransformComponent* transform = entity->getComponent<TransformComponent>();
+		contacts.push_back({ entity, transform ? transform->getTranslation() : glm::vec3(0.f) });
+		m_islandsByContact.emplace(entity, island);
+	}
+
+	void SleepSystem::putIslandsToSleep(float dt) {
+		// Time each awake entity has moved slower than the sleep speed
+		m_awake.clear();
+		m_awakeIndices.clear();
+		for (auto e : entities) {
+			MovementComponent* movement = e->getComponent<MovementComponent>();
+			if (movement->sleeping) {
+				continue;
+			}
+
+			const float speed2 = m_sleepSpeed * m_sleepSpeed;
+			if (glm::length2(movement->velocity) <= speed2 && glm::length2(movement->angularVelocity) <= speed2) {
+				movement->restingTime += dt;
+			}
+			else {
+				movement->restingTime = 0.f;
+			}
+
+			m_awakeIndices[e] = (int)m_awake.size();
+			m_awake.push_back(e);
+		}
+
+		// Join the awake entities touching each other. Entities that don't move, like the ground, don't join islands
+		const int nrOfAwake = (int)m_awake.size();
+		m_parents.resize(nrOfAwake);
+		for (int i = 0; i < nrOfAwake; i++) {
+			m_parents[i] = i;
+		}
+
+		for (int i = 0; i < nrOfAwake; i++) {
+			for (auto& collision : m_awake[i]->getComponent<CollisionComponent>()->collisions) {
+				auto it = m_awakeIndices.find(collision.entity);
+				if (it == m_awakeIndices.end()) {
+					continue;
+				}
+
+				// The lowest index is kept as root so the islands don't depend on the order the contacts are found in
+				const int root1 = findRoot(i);
+				const int root2 = findRoot(it->second);
+				m_parents[glm::max(root1, root2)] = glm::min(root1, root2);
+			}
+		}
+
+		m_islandRestingTimes.assign(nrOfAwake, INFINITY);
+		for (int i = 0; i < nrOfAwake; i++) {
+			float& islandTime = m_islandRestingTimes[findRoot(i)];
+			islandTime = glm::min(islandTime, m_awake[i]->getComponent<MovementComponent>()->restingTime);
+		}
+
+		// Islands that have all rested for long enough fall asleep together
+		m_rootIslands.assign(nrOfAwake, -1);
+		for (int i = 0; i < nrOfAwake; i++) {
+			const int root = findRoot(i);
+			if (m_islandRestingTimes[root] < m_sleepTime) {
+				continue;
+			}
+
+			if (m_rootIslands[root] < 0) {
+				if (m_freeIslands.empty()) {
+					m_rootIslands[root] = (int)m_islands.size();
+					m_islands.emplace_back();
+					m_islandContacts.emplace_back();
+				}
+				else {
+					m_rootIslands[root] = m_freeIslands.back();
+					m_freeIslands.pop_back();
+				}
+			}
+
+			Entity* e = m_awake[i];
+			MovementComponent* movement = e->getComponent<MovementComponent>();
+			movement->velocity = glm::vec3(0.f);
+			movement->oldVelocity = glm::vec3(0.f);
+			movement->accelerationToAdd = glm::vec3(0.f);
+			movement->angularVelocity = glm::vec3(0.f);
+
+			const int island = m_rootIslands[root];
+			m_islands[island].push_back({ e, e->getComponent<TransformComponent>()->getTranslation() });
+			m_islandByEntity[e] = island;
+			for (auto& collision : e->getComponent<CollisionComponent>()->collisions) {
+				addIslandContact(island, collision.entity);
+			}
+			m_scene->setSleeping(e, true);
+		}
+	}
+
+	int SleepSystem::findRoot(int index) {
+		while (m_parents[index] != index) {
+			// Path halving
+			m_parents[index] = m_parents[m_parents[index]];
+			index = m_parents[index];
+		}
+		return index;
+	}
+
+}
\ No newline at end of file
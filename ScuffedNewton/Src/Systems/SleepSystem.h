@@ -0,0 +1,70 @@
+#pragma once
+#include "BaseSystem.h"
+
+#include <unordered_map>
+#include <unordered_set>
+#include <glm/vec3.hpp>
+
+namespace Scuffed {
+
+	class Scene;
+
+	// Groups the moving entities touching each other into islands and puts an island to sleep when all of it has moved slower than the sleep speed for the sleep time.
+	// Sleeping entities are taken out of the systems that skip them, and stay in the broadphase without changing. Runs first, using the collisions found by the previous update
+	class SleepSystem final : public BaseSystem {
+	public:
+		SleepSystem();
+		~SleepSystem();
+
+		void provideScene(Scene* scene);
+		// A time of 0 (default) turns sleeping off and wakes everything on the next update
+		void setSleepThresholds(float speed, float time);
+
+		// Entities joining the system start awake, the islands they slept in are not kept when the systems are recreated
+		bool addEntity(Entity* entity) override;
+		void removeEntity(Entity* entity) override;
+
+		void update(float dt) override;
+
+		// Wakes the islands touching the entity when they fell asleep. Entities outside this system, like a static floor, can be what an island rests on
+		void wakeIslandsTouching(Entity* entity);
+		// Has to be called before any entity is removed from the scene. Wakes the islands touching it,
+		// and keeps the collisions that still point to it until the next update from being used as contacts
+		void prepareRemoval(Entity* entity);
+
+	private:
+		struct SleepingEntity {
+			Entity* entity;
+			glm::vec3 translation; // Where it fell asleep, being moved from the outside wakes it
+		};
+
+		// Wakes the islands of sleeping entities that have been moved or given a velocity, that an awake entity touched, or whose contacts outside the system have moved
+		void wakeChangedIslands();
+		void wakeIsland(int island);
+		// Keeps the entity as a contact of the island if it isn't in this system
+		void addIslandContact(int island, Entity* entity);
+		void putIslandsToSleep(float dt);
+		int findRoot(int index);
+
+		Scene* m_scene;
+		float m_sleepSpeed;
+		float m_sleepTime;
+
+		std::vector<std::vector<SleepingEntity>> m_islands; // Sleeping islands, empty when woken
+		std::vector<int> m_freeIslands;
+		std::unordered_map<Entity*, int> m_islandByEntity; // Keyed by pointer since the collisions from the previous update can point to removed entities
+
+		// The entities outside this system that the islands touched when they fell asleep, with where they were. Indexed like m_islands
+		std::vector<std::vector<SleepingEntity>> m_islandContacts;
+		std::unordered_multimap<Entity*, int> m_islandsByContact;
+		std::unordered_set<Entity*> m_removedEntities; // Removed since the last update
+
+		// Union find over the awake entities, reused between updates
+		std::vector<Entity*> m_awake;
+		std::unordered_map<Entity*, int> m_awakeIndices;
+		std::vector<int> m_parents;
+		std::vector<float> m_islandRestingTimes; // Shortest resting time in the island, indexed by root
+		std::vector<int> m_rootIslands; // Sleeping island the island is put in, indexed by root
+	};
+
+}
\ No newline at end of file
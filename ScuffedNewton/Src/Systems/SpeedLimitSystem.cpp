@@ -7,17 +7,23 @@
 namespace Scuffed {
 
 	SpeedLimitSystem::SpeedLimitSystem() {
-		requiredComponents["MovementComponent"] = true;
-		requiredComponents["SpeedLimitComponent"] = true;
+		requiredComponents.set(MovementComponent::TYPE);
+		requiredComponents.set(SpeedLimitComponent::TYPE);
+
+		readComponents.set(SpeedLimitComponent::TYPE);
+		writtenComponents.set(MovementComponent::TYPE);
+
+		skipSleepingEntities = true;
 	}
 
 	SpeedLimitSystem::~SpeedLimitSystem() {
 	}
 
 	void SpeedLimitSystem::update(float dt) {
-		for (auto& e : entities) {
-			MovementComponent* movement = e->getComponent<MovementComponent>();
-			SpeedLimitComponent* speedLimit = e->getComponent<SpeedLimitComponent>();
+		ComponentPool<MovementComponent>* movements = m_componentRegistry->getPool<MovementComponent>();
+
+		forEachComponent<SpeedLimitComponent>([&](SpeedLimitComponent* speedLimit, unsigned int entityId) {
+			MovementComponent* movement = movements->get(entityId);
 
 			// Retain vertical speed
 			const float ySpeed = movement->velocity.y;
@@ -41,7 +47,7 @@ namespace Scuffed {
 			// Set new velocity while retaining vertical speed
 			newVelocity.y = ySpeed;
 			movement->velocity = newVelocity;
-		}
+		});
 
 		//std::cout << "SpeedLimit system ran\n";
 	}
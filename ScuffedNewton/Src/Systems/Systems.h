@@ -5,5 +5,6 @@
 #include "MovementPostCollisionSystem.h"
 #include "MovementSystem.h"
 #include "OctreeAddRemoverSystem.h"
+#include "SleepSystem.h"
 #include "SpeedLimitSystem.h"
 #include "UpdateBoundingBoxSystem.h"
\ No newline at end of file
@@ -12,8 +12,13 @@
 namespace Scuffed {
 
 	UpdateBoundingBoxSystem::UpdateBoundingBoxSystem() : BaseSystem() {
-		requiredComponents["BoundingBoxComponent"] = true;
-		requiredComponents["TransformComponent"] = true;
+		requiredComponents.set(BoundingBoxComponent::TYPE);
+		requiredComponents.set(TransformComponent::TYPE);
+
+		// Reading the change flags of transforms and meshes clears them
+		writtenComponents.set(TransformComponent::TYPE);
+		writtenComponents.set(MeshComponent::TYPE);
+		writtenComponents.set(BoundingBoxComponent::TYPE);
 	}
 
 	UpdateBoundingBoxSystem::~UpdateBoundingBoxSystem() {
@@ -40,10 +45,7 @@ namespace Scuffed {
 		}
 	}
 
-	void UpdateBoundingBoxSystem::recalculateBoundingBox(Entity* e) {
-		MeshComponent* mesh = e->getComponent<MeshComponent>();
-		BoundingBoxComponent* boundingBox = e->getComponent<BoundingBoxComponent>();
-		TransformComponent* transform = e->getComponent<TransformComponent>();
+	void UpdateBoundingBoxSystem::recalculateBoundingBox(BoundingBoxComponent* boundingBox, TransformComponent* transform, MeshComponent* mesh) {
 		if (mesh && mesh->getChange()) {
 			glm::vec3 minPositions(9999999.0f), maxPositions(-9999999.0f);
 
@@ -70,7 +72,7 @@ namespace Scuffed {
 
 	bool UpdateBoundingBoxSystem::addEntity(Entity* entity) {
 		if (BaseSystem::addEntity(entity)) {
-			recalculateBoundingBox(entity);
+			recalculateBoundingBox(entity->getComponent<BoundingBoxComponent>(), entity->getComponent<TransformComponent>(), entity->getComponent<MeshComponent>());
 			return true;
 		}
 		return false;
@@ -79,14 +81,14 @@ namespace Scuffed {
 	void UpdateBoundingBoxSystem::update(float dt) {
 		//std::cout << "UpdateBoundingBoxSystem system ran\n";
 
-		for (auto& e : entities) {
-			TransformComponent* transform = e->getComponent<TransformComponent>();
-			if (transform) {
-				int change = transform->getChange();
-				if (change > 0) {
-					recalculateBoundingBox(e);
-				}
+		ComponentPool<BoundingBoxComponent>* boundingBoxes = m_componentRegistry->getPool<BoundingBoxComponent>();
+		ComponentPool<MeshComponent>* meshes = m_componentRegistry->getPool<MeshComponent>();
+
+		forEachComponent<TransformComponent>([&](TransformComponent* transform, unsigned int entityId) {
+			int change = transform->getChange();
+			if (change > 0) {
+				recalculateBoundingBox(boundingBoxes->get(entityId), transform, meshes->get(entityId));
 			}
-		}
+		});
 	}
 }
\ No newline at end of file
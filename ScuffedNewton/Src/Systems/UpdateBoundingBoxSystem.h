@@ -3,6 +3,10 @@
 
 namespace Scuffed {
 
+	class BoundingBoxComponent;
+	class TransformComponent;
+	class MeshComponent;
+
 	class UpdateBoundingBoxSystem : public BaseSystem {
 	public:
 		UpdateBoundingBoxSystem();
@@ -14,7 +18,7 @@ namespace Scuffed {
 
 	private:
 		void checkDistances(glm::vec3& minVec, glm::vec3& maxVec, const glm::vec3& testVec);
-		void recalculateBoundingBox(Entity* e);
+		void recalculateBoundingBox(BoundingBoxComponent* boundingBox, TransformComponent* transform, MeshComponent* mesh);
 	};
 
 }
\ No newline at end of file
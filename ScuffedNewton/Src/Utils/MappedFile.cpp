@@ -0,0 +1,116 @@
+#include "../pch.h"
+
+#include "MappedFile.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Scuffed {
+
+	MappedFile::MappedFile() {
+		m_data = nullptr;
+		m_size = 0;
+#ifdef _WIN32
+		m_file = INVALID_HANDLE_VALUE;
+		m_mapping = nullptr;
+#else
+		m_file = -1;
+#endif
+	}
+
+	MappedFile::~MappedFile() {
+		close();
+	}
+
+#ifdef _WIN32
+	bool MappedFile::open(const std::string& path) {
+		close();
+
+		m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (m_file == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0) {
+			close();
+			return false;
+		}
+
+		m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!m_mapping) {
+			close();
+			return false;
+		}
+
+		m_data = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!m_data) {
+			close();
+			return false;
+		}
+		m_size = (size_t)size.QuadPart;
+
+		return true;
+	}
+
+	void MappedFile::close() {
+		if (m_data) {
+			UnmapViewOfFile(m_data);
+		}
+		if (m_mapping) {
+			CloseHandle(m_mapping);
+		}
+		if (m_file != INVALID_HANDLE_VALUE) {
+			CloseHandle(m_file);
+		}
+
+		m_data = nullptr;
+		m_size = 0;
+		m_file = INVALID_HANDLE_VALUE;
+		m_mapping = nullptr;
+	}
+#else
+	bool MappedFile::open(const std::string& path) {
+		close();
+
+		m_file = ::open(path.c_str(), O_RDONLY);
+		if (m_file < 0) {
+			return false;
+		}
+
+		struct stat status;
+		if (fstat(m_file, &status) != 0 || status.st_size == 0) {
+			close();
+			return false;
+		}
+
+		void* data = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+		if (data == MAP_FAILED) {
+			close();
+			return false;
+		}
+		m_data = data;
+		m_size = (size_t)status.st_size;
+
+		return true;
+	}
+
+	void MappedFile::close() {
+		if (m_data) {
+			munmap(const_cast<void*>(m_data), m_size);
+		}
+		if (m_file >= 0) {
+			::close(m_file);
+		}
+
+		m_data = nullptr;
+		m_size = 0;
+		m_file = -1;
+	}
+#endif
+
+}
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+
+namespace Scuffed {
+
+	// Read only view of a whole file, mapped into memory instead of read so nothing is copied until it is used
+	class MappedFile {
+	public:
+		MappedFile();
+		~MappedFile();
+
+		// Closes any file mapped earlier. Returns false if the file could not be opened or is empty
+		bool open(const std::string& path);
+		void close();
+
+		const void* getData() const { return m_data; }
+		size_t getSize() const { return m_size; }
+
+	private:
+		const void* m_data;
+		size_t m_size;
+
+#ifdef _WIN32
+		void* m_file; // HANDLE
+		void* m_mapping; // HANDLE
+#else
+		int m_file;
+#endif
+	};
+
+}
\ No newline at end of file
@@ -0,0 +1,183 @@
+#include "../pch.h"
+
+#include "ThreadPool.h"
+
+namespace Scuffed {
+
+	namespace {
+		// Which pool and queue the current thread works for. Threads that are not workers use queue 0
+		thread_local const ThreadPool* t_pool = nullptr;
+		thread_local int t_threadIndex = 0;
+	}
+
+	ThreadPool::ThreadPool(int nrOfThreads) {
+		m_nrOfQueuedJobs = 0;
+		m_stop = false;
+
+		startWorkers(glm::max(nrOfThreads, 1));
+	}
+
+	ThreadPool::~ThreadPool() {
+		stopWorkers();
+	}
+
+	void ThreadPool::setNrOfThreads(int nrOfThreads) {
+		if (nrOfThreads < 1) {
+			nrOfThreads = 1;
+		}
+
+		if (nrOfThreads != getNrOfThreads()) {
+			stopWorkers();
+			startWorkers(nrOfThreads);
+		}
+	}
+
+	int ThreadPool::getNrOfThreads() const {
+		return (int)m_queues.size();
+	}
+
+	void ThreadPool::submit(const std::function<void()>& job, Counter* counter) {
+		counter->fetch_add(1);
+
+		Queue* queue = m_queues[getThreadIndex()];
+		{
+			std::lock_guard<std::mutex> lock(queue->mutex);
+			queue->jobs.push_back({ job, counter });
+		}
+		m_nrOfQueuedJobs++;
+
+		// Taking the lock makes sure a worker can't miss the new job between checking for jobs and going to sleep
+		{
+			std::lock_guard<std::mutex> lock(m_sleepMutex);
+		}
+		m_jobsAvailable.notify_one();
+	}
+
+	void ThreadPool::wait(Counter* counter) {
+		const int threadIndex = getThreadIndex();
+		while (counter->load() > 0) {
+			if (!tryRunJob(threadIndex)) {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& func) {
+		if (m_workers.empty() || count <= 1) {
+			for (size_t i = 0; i < count; i++) {
+				func(i);
+			}
+			return;
+		}
+
+		// A few chunks per thread so threads that finish early have something to steal
+		const size_t chunkSize = glm::max(count / (size_t)(getNrOfThreads() * 4), (size_t)1);
+
+		Counter counter(0);
+		for (size_t begin = 0; begin < count; begin += chunkSize) {
+			const size_t end = glm::min(begin + chunkSize, count);
+			submit([&func, begin, end] {
+				for (size_t i = begin; i < end; i++) {
+					func(i);
+				}
+			}, &counter);
+		}
+
+		wait(&counter);
+	}
+
+	void ThreadPool::startWorkers(int nrOfThreads) {
+		m_stop = false;
+
+		for (int i = 0; i < nrOfThreads; i++) {
+			m_queues.push_back(SN_NEW Queue());
+		}
+
+		for (int i = 1; i < nrOfThreads; i++) {
+			m_workers.emplace_back(&ThreadPool::workerLoop, this, i);
+		}
+	}
+
+	void ThreadPool::stopWorkers() {
+		{
+			std::lock_guard<std::mutex> lock(m_sleepMutex);
+			m_stop = true;
+		}
+		m_jobsAvailable.notify_all();
+
+		for (auto& worker : m_workers) {
+			worker.join();
+		}
+		m_workers.clear();
+
+		for (auto queue : m_queues) {
+			delete queue;
+		}
+		m_queues.clear();
+	}
+
+	void ThreadPool::workerLoop(int threadIndex) {
+		t_pool = this;
+		t_threadIndex = threadIndex;
+
+		while (true) {
+			if (tryRunJob(threadIndex)) {
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(m_sleepMutex);
+			m_jobsAvailable.wait(lock, [&] { return m_stop || m_nrOfQueuedJobs.load() > 0; });
+			if (m_stop) {
+				return;
+			}
+		}
+	}
+
+	int ThreadPool::getThreadIndex() const {
+		return t_pool == this ? t_threadIndex : 0;
+	}
+
+	bool ThreadPool::popJob(int threadIndex, Job& job) {
+		if (m_nrOfQueuedJobs.load() == 0) {
+			return false;
+		}
+
+		const int nrOfQueues = (int)m_queues.size();
+		for (int i = 0; i < nrOfQueues; i++) {
+			const int queueIndex = (threadIndex + i) % nrOfQueues;
+			Queue* queue = m_queues[queueIndex];
+
+			std::lock_guard<std::mutex> lock(queue->mutex);
+			if (queue->jobs.empty()) {
+				continue;
+			}
+
+			if (queueIndex == threadIndex) {
+				// Own queue, newest job first since its data is most likely still in the cache
+				job = std::move(queue->jobs.back());
+				queue->jobs.pop_back();
+			}
+			else {
+				// Steal the oldest job and leave the newest to the owner
+				job = std::move(queue->jobs.front());
+				queue->jobs.pop_front();
+			}
+			m_nrOfQueuedJobs--;
+			return true;
+		}
+
+		return false;
+	}
+
+	bool ThreadPool::tryRunJob(int threadIndex) {
+		Job job;
+		if (!popJob(threadIndex, job)) {
+			return false;
+		}
+
+		job.func();
+		job.counter->fetch_sub(1);
+		return true;
+	}
+
+}
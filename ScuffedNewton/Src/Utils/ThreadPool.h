@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+namespace Scuffed {
+
+	// Work stealing job system. Every thread has its own job queue, takes the newest job from it and steals the oldest job from another thread when it runs out.
+	// The thread calling wait or parallelFor runs jobs as well, so a pool with one thread has no workers and runs everything on the calling thread.
+	class ThreadPool {
+	public:
+		// Number of submitted jobs that have not finished yet
+		typedef std::atomic<int> Counter;
+
+		ThreadPool(int nrOfThreads = 1);
+		virtual ~ThreadPool();
+
+		// Can not be called while jobs are running
+		virtual void setNrOfThreads(int nrOfThreads);
+		virtual int getNrOfThreads() const;
+
+		// Jobs can submit more jobs to the same counter, wait returns when all of them are done
+		virtual void submit(const std::function<void()>& job, Counter* counter);
+		virtual void wait(Counter* counter);
+
+		// Calls func for every index in [0, count) and returns when all calls are done. Indices are handed out in chunks, in no particular order
+		virtual void parallelFor(size_t count, const std::function<void(size_t)>& func);
+
+		// Index of the calling thread in [0, getNrOfThreads()). Threads outside the pool get 0, like the thread using the pool
+		int getThreadIndex() const;
+
+	private:
+		struct Job {
+			std::function<void()> func;
+			Counter* counter;
+		};
+
+		struct Queue {
+			std::mutex mutex;
+			std::deque<Job> jobs;
+		};
+
+		void startWorkers(int nrOfThreads);
+		void stopWorkers();
+		void workerLoop(int threadIndex);
+		bool popJob(int threadIndex, Job& job);
+		bool tryRunJob(int threadIndex);
+
+	private:
+		std::vector<std::thread> m_workers;
+		std::vector<Queue*> m_queues; // One per thread, index 0 belongs to the thread using the pool
+
+		std::mutex m_sleepMutex;
+		std::condition_variable m_jobsAvailable;
+		std::atomic<int> m_nrOfQueuedJobs;
+		bool m_stop;
+	};
+
+}
@@ -11,18 +11,6 @@
 
 namespace Scuffed {
 
-	namespace Components {
-		enum types {
-			BoundingBoxComponent,
-			CollidableComponent,
-			CollisionComponent,
-			MovementComponent,
-			MeshComponent,
-			SpeedLimitComponent,
-			TransformComponent
-		}; // Change in switch cases in entity virtual functions if this changes
-	}
-
 	class Utils {
 	public:
 		Utils();